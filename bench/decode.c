@@ -0,0 +1,100 @@
+/* Times decoding the postscript, footer, metadata and stripe footers of ORC files held in memory, with
+ * the generic protobuf-c unpack and with the specialized decoders, along with the number of blocks
+ * the arena of each reader requested from malloc.
+ *
+ *   bench/decode [iterations] file.orc...
+ */
+#include <time.h>
+#include "reader.h"
+
+
+static double orc__bench__now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+static uint8_t *orc__bench__load(const char *path, size_t *size) {
+  FILE *fp;
+  if ((fp = fopen(path, "rb")) == NULL) {
+    return NULL;
+  }
+  fseek(fp, 0, SEEK_END);
+  *size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  uint8_t *data = malloc(*size ? *size : 1);
+  if (data != NULL && fread(data, 1, *size, fp) != *size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(fp);
+  return data;
+}
+
+/* Microseconds per decode of the whole tail, including stripe statistics and footers, or a negative
+ * value if the file could not be decoded */
+static double orc__bench__time(uint8_t *data, size_t size, int iterations, int generic, size_t *allocations) {
+  int i;
+  double start = orc__bench__now();
+  for (i=0; i < iterations; ++i) {
+    orc__reader_t *reader;
+    if ((reader = orc__reader__init_from_buffer(data, size, 1, 1)) == NULL) {
+      return -1;
+    }
+    reader->enable_schema = 1;
+    reader->enable_file_stats = 1;
+    reader->generic_unpack = generic;
+    reader->string_views = 1;
+    if (orc__reader__decode(reader) != ORC__OK ||
+        orc__reader__decode_stripe_statistics_range(reader, 0, SIZE_MAX) != ORC__OK) {
+      orc__reader__free(reader);
+      return -1;
+    }
+    *allocations = reader->arena->allocations;
+    orc__reader__free(reader);
+  }
+  return (orc__bench__now()-start)*1e6/iterations;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s iterations file.orc...\n", argv[0]);
+    return 1;
+  }
+  int iterations = atoi(argv[1]);
+
+  int i, failed = 0;
+  size_t allocations = 0;
+  double generic, specialized, total_generic = 0, total_specialized = 0;
+
+  printf("%-64s %14s %14s %8s %12s\n", "file", "generic us", "specialized us", "speedup", "allocations");
+  for (i=2; i < argc; ++i) {
+    size_t size;
+    uint8_t *data;
+    if ((data = orc__bench__load(argv[i], &size)) == NULL) {
+      fprintf(stderr, "%s: could not read file\n", argv[i]);
+      return 1;
+    }
+
+    /* Generic protobuf-c unpack against the orc__message__ decoders */
+    generic = orc__bench__time(data, size, iterations, 1, &allocations);
+    specialized = orc__bench__time(data, size, iterations, 0, &allocations);
+    free(data);
+    if (generic < 0 || specialized < 0) {
+      fprintf(stderr, "%s: could not decode file\n", argv[i]);
+      failed = 1;
+      continue;
+    }
+
+    printf("%-64s %14.2f %14.2f %7.2fx %12zu\n", argv[i], generic, specialized, generic/specialized, allocations);
+    total_generic += generic;
+    total_specialized += specialized;
+  }
+
+  if (total_specialized > 0) {
+    printf("%-64s %14.2f %14.2f %7.2fx\n", "total", total_generic, total_specialized,
+           total_generic/total_specialized);
+  }
+  return failed;
+}
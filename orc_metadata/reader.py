@@ -1,24 +1,49 @@
-import boto3
-import tempfile
-from _orc_metadata import read_metadata, ORCReadException
+import sys
+import threading
+from _orc_metadata import (read_metadata, read_metadata_buffer,
+                           read_metadata_many, read_metadata_json,
+                           read_metadata_buffer_json, open_metadata,
+                           open_metadata_buffer, OrcMetadata, ColumnStats,
+                           StreamInfo, EncodingInfo, tail_length,
+                           ORCReadException)
 
+if sys.version_info[0] < 3:
+    import Queue as queue
+else:
+    import queue
 
-class SequenceFileStream(object):
-    def __init__(self, file_stream):
-        self._file = tempfile.NamedTemporaryFile()
-        self._stream = file_stream
 
-    def __enter__(self):
-        self._file.write(self._stream.read())
-        self._file.seek(0)
-        return self._file.name
+# Trailing bytes fetched first in adaptive mode, enough for most footers.
+ADAPTIVE_FETCH_SIZE = 16384
 
-    def __exit__(self, *exc_args):
-        self._file.close()
 
+def _fetch_tail(s3, object_kwargs, size, stripe_stats, requests=None):
+    """Fetch a small tail first, then exactly the trailing bytes missing."""
+    body = b''
+    needed = min(size, ADAPTIVE_FETCH_SIZE)
+    while needed > len(body):
+        byte_range = 'bytes={}-{}'.format(size - needed, size - len(body) - 1)
+        resp = _get_object(s3, requests, Range=byte_range, **object_kwargs)
+        body = resp['Body'].read() + body
+        needed = min(size, tail_length(body, stripe_stats=stripe_stats))
+    return body
 
-def _streamed_files(s3_bucket, s3_prefix, fetch_size):
-    s3 = boto3.client('s3')
+
+def _get_object(s3, requests, **object_kwargs):
+    if requests is None:
+        return s3.get_object(**object_kwargs)
+    with requests:
+        return s3.get_object(**object_kwargs)
+
+
+def _s3_client(client):
+    if client is None:
+        import boto3
+        client = boto3.client('s3')
+    return client
+
+
+def _list_objects(s3, s3_bucket, s3_prefix):
     paginator = s3.get_paginator('list_objects')
     operation_parameters = {'Bucket': s3_bucket,
                             'Prefix': s3_prefix}
@@ -27,17 +52,213 @@ def _streamed_files(s3_bucket, s3_prefix, fetch_size):
         for obj in result.get('Contents', []):
             if obj.get('Key').endswith('$folder$'):
                 continue
-            object_kwargs = {'Bucket': s3_bucket, 'Key': obj.get('Key')}
-            if fetch_size:
-                byte_range = 'bytes={}-'.format(obj.get('Size') - fetch_size)
-                object_kwargs['Range'] = byte_range
-            resp = s3.get_object(**object_kwargs)
-            yield SequenceFileStream(resp['Body'])
+            yield obj
+
+
+def _fetch_object(s3, s3_bucket, obj, fetch_size, stripe_stats, stripes,
+                  requests=None):
+    object_kwargs = {'Bucket': s3_bucket, 'Key': obj.get('Key')}
+    if fetch_size == 'auto' and not stripes:
+        return _fetch_tail(s3, object_kwargs, obj.get('Size'), stripe_stats,
+                           requests)
+    if fetch_size and fetch_size != 'auto':
+        # A suffix range, which returns the whole object when it is smaller
+        byte_range = 'bytes=-{}'.format(fetch_size)
+        object_kwargs['Range'] = byte_range
+    resp = _get_object(s3, requests, **object_kwargs)
+    return resp['Body'].read()
+
+
+def _fetch_estimate(obj, fetch_size, stripes):
+    """Bytes expected in flight for an object, before its tail is decoded."""
+    size = obj.get('Size')
+    if fetch_size == 'auto' and not stripes:
+        return min(size, ADAPTIVE_FETCH_SIZE)
+    if fetch_size and fetch_size != 'auto':
+        return min(size, fetch_size)
+    return size
+
+
+def _streamed_files(s3_bucket, s3_prefix, fetch_size, stripe_stats=False,
+                    stripes=False, client=None):
+    s3 = _s3_client(client)
+    for obj in _list_objects(s3, s3_bucket, s3_prefix):
+        yield _fetch_object(s3, s3_bucket, obj, fetch_size, stripe_stats,
+                            stripes)
 
 
 def read_metadata_s3(s3_bucket, s3_prefix, fetch_size=None, schema=False,
-                     file_stats=False, stripe_stats=False, stripes=False):
-    for seq_file in _streamed_files(s3_bucket, s3_prefix, fetch_size):
-        with seq_file as temp_file:
-            yield read_metadata(temp_file, schema=schema, file_stats=file_stats,
-                                stripe_stats=stripe_stats, stripes=stripes)
+                     file_stats=False, stripe_stats=False, stripes=False,
+                     client=None, columns=None, stripe_range=None,
+                     records=False):
+    for body in _streamed_files(s3_bucket, s3_prefix, fetch_size,
+                                stripe_stats=stripe_stats, stripes=stripes,
+                                client=client):
+        yield read_metadata_buffer(body, schema=schema, file_stats=file_stats,
+                                   stripe_stats=stripe_stats, stripes=stripes,
+                                   columns=columns,
+                                   stripe_range=stripe_range,
+                                   records=records)
+
+
+class _ByteBudget(object):
+    """Caps the bytes fetched but not yet decoded across all workers."""
+
+    def __init__(self, max_bytes):
+        self._max_bytes = max_bytes
+        self._in_flight = 0
+        self._cond = threading.Condition()
+
+    def acquire(self, size):
+        with self._cond:
+            # A single object larger than the budget is let through alone
+            while self._in_flight and self._in_flight + size > self._max_bytes:
+                self._cond.wait()
+            self._in_flight += size
+
+    def grow(self, size):
+        """Account for bytes beyond the estimate, which are already fetched."""
+        with self._cond:
+            self._in_flight += size
+
+    def release(self, size):
+        with self._cond:
+            self._in_flight -= size
+            self._cond.notify_all()
+
+
+class _Scanner(object):
+
+    def __init__(self, s3, s3_bucket, s3_prefix, fetch_size, workers,
+                 max_inflight_bytes, max_inflight_requests, read_kwargs):
+        self.s3 = s3
+        self.s3_bucket = s3_bucket
+        self.s3_prefix = s3_prefix
+        self.fetch_size = fetch_size
+        self.read_kwargs = read_kwargs
+        self.budget = _ByteBudget(max_inflight_bytes)
+        self.requests = threading.BoundedSemaphore(max_inflight_requests)
+        self.pending = queue.Queue(maxsize=workers * 2)
+        self.results = queue.Queue()
+        self.stopped = threading.Event()
+        self.threads = [threading.Thread(target=self._list)]
+        self.threads += [threading.Thread(target=self._work)
+                         for _ in range(workers)]
+        self.workers = workers
+
+    def start(self):
+        for thread in self.threads:
+            thread.daemon = True
+            thread.start()
+
+    def stop(self):
+        self.stopped.set()
+        for thread in self.threads:
+            thread.join()
+
+    def _put_pending(self, item):
+        while not self.stopped.is_set():
+            try:
+                self.pending.put(item, timeout=0.1)
+                return
+            except queue.Full:
+                continue
+
+    def _list(self):
+        count = 0
+        try:
+            for obj in _list_objects(self.s3, self.s3_bucket, self.s3_prefix):
+                if self.stopped.is_set():
+                    return
+                self._put_pending((count, obj))
+                count += 1
+        except Exception as e:
+            self.results.put((count, None, e, True))
+            count += 1
+        finally:
+            self.results.put((count, None, None, False))
+            for _ in range(self.workers):
+                self._put_pending(None)
+
+    def _work(self):
+        stripes = self.read_kwargs['stripes']
+        stripe_stats = self.read_kwargs['stripe_stats']
+        while not self.stopped.is_set():
+            try:
+                item = self.pending.get(timeout=0.1)
+            except queue.Empty:
+                continue
+            if item is None:
+                return
+            index, obj = item
+            estimate = _fetch_estimate(obj, self.fetch_size, stripes)
+            self.budget.acquire(estimate)
+            try:
+                body = _fetch_object(self.s3, self.s3_bucket, obj,
+                                     self.fetch_size, stripe_stats, stripes,
+                                     self.requests)
+                if len(body) > estimate:
+                    self.budget.grow(len(body) - estimate)
+                    estimate = len(body)
+                result = (index, obj.get('Key'),
+                          read_metadata_buffer(body, **self.read_kwargs),
+                          False)
+            except Exception as e:
+                result = (index, obj.get('Key'), e, True)
+            finally:
+                self.budget.release(estimate)
+            self.results.put(result)
+
+    def results_iter(self, ordered):
+        total = None
+        done = 0
+        held = {}
+        next_index = 0
+        while total is None or done < total:
+            index, key, value, failed = self.results.get()
+            if key is None and not failed:
+                total = index
+                continue
+            done += 1
+            if not ordered:
+                yield key, value, failed
+                continue
+            held[index] = (key, value, failed)
+            while next_index in held:
+                yield held.pop(next_index)
+                next_index += 1
+
+
+def read_metadata_s3_concurrent(s3_bucket, s3_prefix, fetch_size='auto',
+                                schema=False, file_stats=False,
+                                stripe_stats=False, stripes=False,
+                                workers=16, max_inflight_bytes=64 << 20,
+                                max_inflight_requests=None, ordered=False,
+                                client=None, columns=None,
+                                stripe_range=None, records=False):
+    """Yield (key, metadata) for each ORC object under s3_prefix.
+
+    Listing is pipelined with range GETs and decoding on a pool of worker
+    threads. Fetched but undecoded bytes are capped by max_inflight_bytes
+    and concurrent GETs by max_inflight_requests. Results are yielded in
+    completion order, or in listing order if ordered is set. The first
+    failed object raises its exception and stops the scan.
+    """
+    if max_inflight_requests is None:
+        max_inflight_requests = workers
+    read_kwargs = {'schema': schema, 'file_stats': file_stats,
+                   'stripe_stats': stripe_stats, 'stripes': stripes,
+                   'columns': columns, 'stripe_range': stripe_range,
+                   'records': records}
+
+    scanner = _Scanner(_s3_client(client), s3_bucket, s3_prefix, fetch_size,
+                       workers, max_inflight_bytes, max_inflight_requests,
+                       read_kwargs)
+    scanner.start()
+    try:
+        for key, value, failed in scanner.results_iter(ordered):
+            if failed:
+                raise value
+            yield key, value
+    finally:
+        scanner.stop()
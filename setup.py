@@ -1,15 +1,46 @@
+import os
 import platform
-from distutils.core import setup, Extension
+import shutil
+import tempfile
+try:
+    from setuptools import setup, Extension
+except ImportError:
+    from distutils.core import setup, Extension
+from distutils.ccompiler import new_compiler
+from distutils.errors import CompileError
+from distutils.sysconfig import customize_compiler
 from ctypes.util import find_library
 
 
-compression_libraries = ['z', 'snappy', 'lz4', 'lzo']
-compression_flags = ['HAS_ZLIB', 'HAS_SNAPPY', 'HAS_LZ4', 'HAS_LZO']
+compression_libraries = ['z', 'snappy', 'lz4', 'lzo', 'zstd']
+compression_headers = ['zlib.h', 'snappy-c.h', 'lz4.h', 'lzo.h', 'zstd.h']
+compression_flags = ['HAS_ZLIB', 'HAS_SNAPPY', 'HAS_LZ4', 'HAS_LZO',
+                     'HAS_ZSTD']
 compression_macros = []
 
+
+def has_header(header):
+    # A library can be installed without its development headers
+    compiler = new_compiler()
+    customize_compiler(compiler)
+    directory = tempfile.mkdtemp()
+    try:
+        source = os.path.join(directory, 'check.c')
+        with open(source, 'w') as f:
+            f.write('#include "{h}"\nint main(void) {{ return 0; }}\n'
+                    .format(h=header))
+        compiler.compile([source], output_dir=directory)
+        return True
+    except CompileError:
+        return False
+    finally:
+        shutil.rmtree(directory)
+
+
 libraries = []
-for lib, flag in zip(compression_libraries, compression_flags):
-    if find_library(lib):
+for lib, header, flag in zip(compression_libraries, compression_headers,
+                             compression_flags):
+    if find_library(lib) and has_header(header):
         libraries.append(lib)
         compression_macros.append((flag, '1'))
 
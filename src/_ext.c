@@ -1,647 +1,2289 @@
 #include <Python.h>
 #include "reader.h"
+#include "batch.h"
+#include "columnar.h"
+#include "arrow.h"
+#include "schema.h"
+#include "json.h"
 
 #define Py_MEMCHECK(val) if (val == NULL) return PyErr_NoMemory();
-#define PyString_CONCAT(string, newpart) PyString_Concat(string, newpart); Py_DECREF(newpart);
+
+/* Python 3 returns text as str, which ORC stores as UTF-8. Bytes that are not valid UTF-8 are kept as
+ * surrogates so that nothing is lost. File contents must be bytes-like there, str is not encoded into them. */
+#if PY_MAJOR_VERSION >= 3
+#define PyString_FromString PyUnicode_FromString
+#define PyString_FromFormat PyUnicode_FromFormat
+#define PyString_InternFromString PyUnicode_InternFromString
+#define PyString_FromStringAndSize(value, size) PyUnicode_DecodeUTF8(value, size, "surrogateescape")
+#define PyString_AsString PyUnicode_AsUTF8
+#define PyString_Check PyUnicode_Check
+#define PyInt_FromSsize_t PyLong_FromSsize_t
+#define ORC__SLICE(object) (object)
+#define ORC__BUFFER "y*"
+#else
+#include <structseq.h>
+#define ORC__SLICE(object) ((PySliceObject *) (object))
+#define ORC__BUFFER "s*"
+#define PySlice_Unpack _PySlice_Unpack
+#define PyStructSequence_InitType2(type, desc) (PyStructSequence_InitType(type, desc), 0)
+#endif
+
+/* Keys of the result dicts, interned once by orc__init_module so that building a dict neither allocates nor
+ * hashes its keys */
+#define ORC__KEY__COLUMN             0
+#define ORC__KEY__HAS_NULL           1
+#define ORC__KEY__COUNT              2
+#define ORC__KEY__MIN                3
+#define ORC__KEY__MAX                4
+#define ORC__KEY__SUM                5
+#define ORC__KEY__STRIPE             6
+#define ORC__KEY__STATISTICS         7
+#define ORC__KEY__OFFSET             8
+#define ORC__KEY__DATA               9
+#define ORC__KEY__ROWS               10
+#define ORC__KEY__TAIL               11
+#define ORC__KEY__INDEX              12
+#define ORC__KEY__SECTION            13
+#define ORC__KEY__START              14
+#define ORC__KEY__LENGTH             15
+#define ORC__KEY__ENCODING           16
+#define ORC__KEY__STREAMS            17
+#define ORC__KEY__ENCODINGS          18
+#define ORC__KEY__COMPRESSION        19
+#define ORC__KEY__VERSION            20
+#define ORC__KEY__COMPRESSION_SIZE   21
+#define ORC__KEY__SCHEMA             22
+#define ORC__KEY__STRIPE_STATISTICS  23
+#define ORC__KEY__FILE_STATISTICS    24
+#define ORC__KEY__STRIPES            25
+#define ORC__KEY__KIND               26
+#define ORC__KEY__HAS_BOUNDS         27
+#define ORC__KEY__HAS_SUM            28
+#define ORC__KEYS                    29
+
+#define ORC__KEY(name)  orc__keys[ORC__KEY__##name]
+
+static const char *orc__key_names[ORC__KEYS] = {
+  "column",
+  "has null",
+  "count",
+  "min",
+  "max",
+  "sum",
+  "stripe",
+  "statistics",
+  "offset",
+  "data",
+  "rows",
+  "tail",
+  "index",
+  "section",
+  "start",
+  "length",
+  "encoding",
+  "Streams",
+  "Encodings",
+  "compression",
+  "version",
+  "compression_size",
+  "schema",
+  "Stripe Statistics",
+  "File Statistics",
+  "Stripes",
+  "kind",
+  "has bounds",
+  "has sum"
+};
+
+/* Objects of the names in core.h and of the column_stats kinds, created once by orc__init_module. Dictionary
+ * encodings carry their size, so they are formatted for each column. */
+#define ORC__COLUMNAR_KINDS     6
+
+/* File versions whose version strings are created up front, 0.11 and 0.12 */
+#define ORC__FILE_VERSION_MINOR  11
+#define ORC__FILE_VERSIONS       2
+
+static const char *orc__columnar_kind_names[ORC__COLUMNAR_KINDS] = {
+  NULL, "int", "double", "date", "string", "decimal"
+};
+
+/* Compressions the reader was built with, exported as the compressions tuple of the module */
+static const char *orc__compiled_compressions[] = {
+  "NONE",
+#ifdef HAS_ZLIB
+  "ZLIB",
+#endif
+#ifdef HAS_SNAPPY
+  "SNAPPY",
+#endif
+#ifdef HAS_LZO
+  "LZO",
+#endif
+#ifdef HAS_LZ4
+  "LZ4",
+#endif
+#ifdef HAS_ZSTD
+  "ZSTD",
+#endif
+  NULL
+};
+
+static PyObject *orc__keys[ORC__KEYS];
+static PyObject *orc__compressions[ORC__COMPRESSION_KINDS];
+static PyObject *orc__stream_kinds[ORC__STREAM_KINDS];
+static PyObject *orc__encodings[ORC__ENCODING_KINDS];
+static PyObject *orc__columnar_kinds[ORC__COLUMNAR_KINDS];
+static PyObject *orc__versions[ORC__FILE_VERSIONS][ORC__WRITER_VERSIONS];
+
+/* Schemas memoized by orc__build_schema_string, cleared whenever it grows to this many */
+#define ORC__SCHEMA_CACHE_SIZE  256
 
 static PyObject *ORCReadException;
+static PyObject *orc__schema_cache;
 static PyObject *read_metadata(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *read_metadata_buffer(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *tail_length(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *read_metadata_buffer_generic(PyObject *self, PyObject *args);
+static PyObject *open_metadata(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *open_metadata_buffer(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *orc__read_metadata(orc__reader_t *reader, int enable_schema, int enable_file_stats,
+                                    int enable_stripe_stats, int enable_stripes, int decompress_threads,
+                                    PyObject *stripe_range, int records);
+static PyObject *read_metadata_many(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *read_metadata_json(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *read_metadata_buffer_json(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject *orc__write_json(orc__reader_t *reader, int enable_schema, int enable_file_stats,
+                                 int enable_stripe_stats, int enable_stripes, int decompress_threads,
+                                 PyObject *stripe_range, int ndjson, PyObject *output);
+static PyObject *orc__build_metadata(orc__reader_t *reader, int decode_status, int enable_schema,
+                                     int enable_file_stats, int enable_stripe_stats, int enable_stripes,
+                                     Py_ssize_t start, Py_ssize_t step, Py_ssize_t stripe_count, int records);
+static int orc__column_indexes(orc__arena_t *arena, PyObject *columns, uint64_t **indexes, Py_ssize_t *n);
+static int orc__select_columns(orc__reader_t *reader, PyObject *columns);
+static PyObject *orc__string(orc__reader_t *reader, const char *value);
+static PyObject *orc__decode_error(int decode_status);
+
+
+static PyObject *read_metadata(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+  const char *input_path;
+  int enable_schema = 0;
+  int enable_file_stats = 0;
+  int enable_stripe_stats = 0;
+  int enable_stripes = 0;
+  int use_mmap = 0;
+  int decompress_threads = 1;
+  PyObject *columns = Py_None;
+  PyObject *stripe_range = Py_None;
+  int records = 0;
+  static char *kwlist[] = {"input_path", "schema", "file_stats", "stripe_stats", "stripes", "use_mmap", 
+                           "decompress_threads", "columns", "stripe_range", "records", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|iiiiiiOOi", kwlist, &input_path, &enable_schema,
+                                   &enable_file_stats, &enable_stripe_stats, &enable_stripes, &use_mmap,
+                                   &decompress_threads, &columns, &stripe_range, &records)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  /* Initialize reader, which reads the tail of the file, without holding the GIL */
+  orc__reader_t *reader;
+  Py_BEGIN_ALLOW_THREADS
+  if (use_mmap) {
+    reader = orc__reader__init_mmap(input_path, enable_stripe_stats, enable_stripes);
+  }
+  else {
+    reader = orc__reader__init(input_path, enable_stripe_stats, enable_stripes);
+  }
+  Py_END_ALLOW_THREADS
+  if (reader == NULL) {
+    PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *) input_path);
+    return NULL;
+  }
+
+  if (orc__select_columns(reader, columns) != 0) {
+    orc__reader__free(reader);
+    return NULL;
+  }
+
+  return orc__read_metadata(reader, enable_schema, enable_file_stats, enable_stripe_stats, enable_stripes,
+                            decompress_threads, stripe_range, records);
+}
+
+static PyObject *read_metadata_buffer(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+  Py_buffer input;
+  int enable_schema = 0;
+  int enable_file_stats = 0;
+  int enable_stripe_stats = 0;
+  int enable_stripes = 0;
+  int decompress_threads = 1;
+  PyObject *columns = Py_None;
+  PyObject *stripe_range = Py_None;
+  int records = 0;
+  static char *kwlist[] = {"input", "schema", "file_stats", "stripe_stats", "stripes", "decompress_threads", 
+                           "columns", "stripe_range", "records", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, ORC__BUFFER "|iiiiiOOi", kwlist, &input, &enable_schema,
+                                   &enable_file_stats, &enable_stripe_stats, &enable_stripes,
+                                   &decompress_threads, &columns, &stripe_range, &records)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  /* Initialize reader over the caller's memory, which stays valid until the buffer is released */
+  orc__reader_t *reader;
+  if ((reader = orc__reader__init_from_buffer((uint8_t *) input.buf, input.len, 
+                                              enable_stripe_stats, enable_stripes)) == NULL) {
+    PyBuffer_Release(&input);
+    return PyErr_NoMemory();
+  }
+
+  if (orc__select_columns(reader, columns) != 0) {
+    orc__reader__free(reader);
+    PyBuffer_Release(&input);
+    return NULL;
+  }
+
+  PyObject *ret = orc__read_metadata(reader, enable_schema, enable_file_stats, enable_stripe_stats, enable_stripes,
+                                     decompress_threads, stripe_range, records);
+  PyBuffer_Release(&input);
+  return ret;
+}
+
+static PyObject *read_metadata_json(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+  const char *input_path;
+  int enable_schema = 0;
+  int enable_file_stats = 0;
+  int enable_stripe_stats = 0;
+  int enable_stripes = 0;
+  int use_mmap = 0;
+  int decompress_threads = 1;
+  PyObject *columns = Py_None;
+  PyObject *stripe_range = Py_None;
+  int ndjson = 0;
+  PyObject *output = Py_None;
+  static char *kwlist[] = {"input_path", "schema", "file_stats", "stripe_stats", "stripes", "use_mmap", 
+                           "decompress_threads", "columns", "stripe_range", "ndjson", "output", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|iiiiiiOOiO", kwlist, &input_path, &enable_schema,
+                                   &enable_file_stats, &enable_stripe_stats, &enable_stripes, &use_mmap,
+                                   &decompress_threads, &columns, &stripe_range, &ndjson, &output)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  orc__reader_t *reader;
+  Py_BEGIN_ALLOW_THREADS
+  if (use_mmap) {
+    reader = orc__reader__init_mmap(input_path, enable_stripe_stats, enable_stripes);
+  }
+  else {
+    reader = orc__reader__init(input_path, enable_stripe_stats, enable_stripes);
+  }
+  Py_END_ALLOW_THREADS
+  if (reader == NULL) {
+    PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *) input_path);
+    return NULL;
+  }
+
+  if (orc__select_columns(reader, columns) != 0) {
+    orc__reader__free(reader);
+    return NULL;
+  }
+
+  return orc__write_json(reader, enable_schema, enable_file_stats, enable_stripe_stats, enable_stripes,
+                         decompress_threads, stripe_range, ndjson, output);
+}
+
+static PyObject *read_metadata_buffer_json(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+  Py_buffer input;
+  int enable_schema = 0;
+  int enable_file_stats = 0;
+  int enable_stripe_stats = 0;
+  int enable_stripes = 0;
+  int decompress_threads = 1;
+  PyObject *columns = Py_None;
+  PyObject *stripe_range = Py_None;
+  int ndjson = 0;
+  PyObject *output = Py_None;
+  static char *kwlist[] = {"input", "schema", "file_stats", "stripe_stats", "stripes", "decompress_threads", 
+                           "columns", "stripe_range", "ndjson", "output", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, ORC__BUFFER "|iiiiiOOiO", kwlist, &input, &enable_schema,
+                                   &enable_file_stats, &enable_stripe_stats, &enable_stripes,
+                                   &decompress_threads, &columns, &stripe_range, &ndjson, &output)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  orc__reader_t *reader;
+  if ((reader = orc__reader__init_from_buffer((uint8_t *) input.buf, input.len, 
+                                              enable_stripe_stats, enable_stripes)) == NULL) {
+    PyBuffer_Release(&input);
+    return PyErr_NoMemory();
+  }
+
+  if (orc__select_columns(reader, columns) != 0) {
+    orc__reader__free(reader);
+    PyBuffer_Release(&input);
+    return NULL;
+  }
+
+  PyObject *ret = orc__write_json(reader, enable_schema, enable_file_stats, enable_stripe_stats, enable_stripes,
+                                  decompress_threads, stripe_range, ndjson, output);
+  PyBuffer_Release(&input);
+  return ret;
+}
+
+/* Exception set by a failed read of one file of a batch, which is returned as its result */
+static PyObject *orc__fetch_exception(void) {
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback);
+  PyErr_NormalizeException(&type, &value, &traceback);
+  Py_XDECREF(type);
+  Py_XDECREF(traceback);
+  return value;
+}
+
+static PyObject *read_metadata_many(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+  PyObject *paths;
+  int threads = 4;
+  int enable_schema = 0;
+  int enable_file_stats = 0;
+  int enable_stripe_stats = 0;
+  int enable_stripes = 0;
+  int use_mmap = 0;
+  int decompress_threads = 1;
+  PyObject *columns = Py_None;
+  PyObject *stripe_range = Py_None;
+  int ordered = 1;
+  int records = 0;
+  static char *kwlist[] = {"paths", "threads", "schema", "file_stats", "stripe_stats", "stripes", "use_mmap",
+                           "decompress_threads", "columns", "stripe_range", "ordered", "records", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iiiiiiiOOii", kwlist, &paths, &threads, &enable_schema,
+                                   &enable_file_stats, &enable_stripe_stats, &enable_stripes, &use_mmap,
+                                   &decompress_threads, &columns, &stripe_range, &ordered, &records)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+  if (stripe_range != Py_None && !PySlice_Check(stripe_range)) {
+    PyErr_SetString(PyExc_TypeError, "stripe_range must be a slice.");
+    return NULL;
+  }
+
+  /* The paths stay referenced by a tuple of them until every file was read. A list passed in could be changed by
+   * another thread while the GIL is released, freeing a path a worker still reads, so it is copied. */
+  PyObject *sequence;
+  if ((sequence = PySequence_Tuple(paths)) == NULL) {
+    if (PyErr_ExceptionMatches(PyExc_TypeError)) {
+      PyErr_SetString(PyExc_TypeError, "paths must be a sequence of file paths.");
+    }
+    return NULL;
+  }
+  Py_ssize_t i, n = PySequence_Fast_GET_SIZE(sequence);
+
+  orc__batch_t *batch;
+  if ((batch = orc__batch__init(n, threads)) == NULL) {
+    Py_DECREF(sequence);
+    return PyErr_NoMemory();
+  }
+  batch->use_mmap = use_mmap;
+  batch->enable_schema = enable_schema;
+  batch->enable_file_stats = enable_file_stats;
+  batch->enable_stripe_stats = enable_stripe_stats;
+  batch->enable_stripes = enable_stripes;
+  batch->decompress_threads = decompress_threads;
+
+  for (i=0; i < n; ++i) {
+    if ((batch->files[i].path = PyString_AsString(PySequence_Fast_GET_ITEM(sequence, i))) == NULL) {
+      goto error;
+    }
+  }
+  if (columns != Py_None) {
+    Py_ssize_t n_columns;
+    if (orc__column_indexes(batch->arena, columns, &batch->columns, &n_columns) != 0) {
+      goto error;
+    }
+    batch->n_columns = n_columns;
+  }
+  if (stripe_range != Py_None) {
+    if (PySlice_Unpack(stripe_range, &batch->stripe_range_start, &batch->stripe_range_stop,
+                       &batch->stripe_range_step) != 0) {
+      goto error;
+    }
+    batch->has_stripe_range = 1;
+  }
+
+  PyObject *ret;
+  if ((ret = PyList_New(n)) == NULL) {
+    goto error;
+  }
+  if (orc__batch__start(batch) != ORC__OK) {
+    Py_DECREF(ret);
+    PyErr_NoMemory();
+    goto error;
+  }
+
+  /* Files are turned into results as they complete, while the pool keeps reading the next ones */
+  int status;
+  size_t index, k = 0;
+  orc__batch_file_t *file;
+  PyObject *value, *item;
+  for (;;) {
+    Py_BEGIN_ALLOW_THREADS
+    status = orc__batch__next(batch, &index);
+    Py_END_ALLOW_THREADS
+    if (status != ORC__OK) {
+      break;
+    }
+
+    file = &batch->files[index];
+    if (file->reader == NULL) {
+      errno = file->err;
+      PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *) file->path);
+      value = NULL;
+    }
+    else {
+      value = orc__build_metadata(file->reader, file->status, enable_schema, enable_file_stats,
+                                  enable_stripe_stats, enable_stripes, file->stripe_start, file->stripe_step,
+                                  file->stripe_count, records);
+    }
+    if (value == NULL && (value = orc__fetch_exception()) == NULL) {
+      Py_DECREF(ret);
+      PyErr_NoMemory();
+      goto error;
+    }
+
+    if ((item = Py_BuildValue("(ON)", PySequence_Fast_GET_ITEM(sequence, index), value)) == NULL) {
+      Py_DECREF(ret);
+      goto error;
+    }
+    PyList_SET_ITEM(ret, ordered ? (Py_ssize_t) index : (Py_ssize_t) k, item);
+    k++;
+
+    if (PyErr_CheckSignals() != 0) {
+      Py_DECREF(ret);
+      goto error;
+    }
+  }
+
+  orc__batch__free(batch);
+  Py_DECREF(sequence);
+  return ret;
+
+error:
+  orc__batch__free(batch);
+  Py_DECREF(sequence);
+  return NULL;
+}
+
+static PyObject *tail_length(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+  Py_buffer input;
+  int enable_stripe_stats = 0;
+  static char *kwlist[] = {"input", "stripe_stats", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, ORC__BUFFER "|i", kwlist, &input, &enable_stripe_stats)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  orc__reader_t *reader;
+  if ((reader = orc__reader__init_from_buffer((uint8_t *) input.buf, input.len, enable_stripe_stats, 0)) == NULL) {
+    PyBuffer_Release(&input);
+    return PyErr_NoMemory();
+  }
+
+  uint64_t length;
+  int status = orc__reader__tail_length(reader, &length);
+  orc__reader__free(reader);
+  PyBuffer_Release(&input);
+
+  if (status != ORC__OK) {
+    PyErr_SetString(ORCReadException, "Could not decode postscript.");
+    return NULL;
+  }
+  return Py_BuildValue("K", length);
+}
+
+/* Everything read_metadata_buffer can read, unpacked by protobuf-c alone into NUL terminated copies. Only meant
+ * for checking the straight-line decoders and their string views against it. */
+static PyObject *read_metadata_buffer_generic(PyObject *self, PyObject *args) {
+
+  Py_buffer input;
+  if (!PyArg_ParseTuple(args, ORC__BUFFER, &input)) {
+    return NULL;
+  }
+
+  orc__reader_t *reader;
+  if ((reader = orc__reader__init_from_buffer((uint8_t *) input.buf, input.len, 1, 1)) == NULL) {
+    PyBuffer_Release(&input);
+    return PyErr_NoMemory();
+  }
+  reader->generic_unpack = 1;
+
+  PyObject *ret = orc__read_metadata(reader, 1, 1, 1, 1, 1, Py_None, 0);
+  PyBuffer_Release(&input);
+  return ret;
+}
+
+/* Convert a sequence of column indexes into an array allocated from the arena. Without an arena it is allocated
+ * with PyMem_Malloc and has to be released with PyMem_Free, so that scratch arrays do not pile up in an arena. */
+static int orc__column_indexes(orc__arena_t *arena, PyObject *columns, uint64_t **output, Py_ssize_t *n) {
+  PyObject *sequence;
+  if ((sequence = PySequence_Fast(columns, "columns must be a sequence of column indexes.")) == NULL) {
+    return -1;
+  }
+
+  Py_ssize_t i;
+  uint64_t *indexes;
+  *n = PySequence_Fast_GET_SIZE(sequence);
+  if (arena != NULL) {
+    indexes = orc__arena__alloc(arena, sizeof(uint64_t)*(*n));
+  }
+  else {
+    indexes = PyMem_Malloc(sizeof(uint64_t)*(*n > 0 ? *n : 1));
+  }
+  if (indexes == NULL) {
+    Py_DECREF(sequence);
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  PY_LONG_LONG index;
+  for (i=0; i < *n; ++i) {
+    index = PyLong_AsLongLong(PySequence_Fast_GET_ITEM(sequence, i));
+    if (index < 0) {
+      if (!PyErr_Occurred()) {
+        PyErr_SetString(PyExc_ValueError, "Column indexes must not be negative.");
+      }
+      if (arena == NULL) {
+        PyMem_Free(indexes);
+      }
+      Py_DECREF(sequence);
+      return -1;
+    }
+    indexes[i] = index;
+  }
+  Py_DECREF(sequence);
+  *output = indexes;
+  return 0;
+}
+
+/* Restrict the decoded statistics to a sequence of column indexes, None keeps every column */
+static int orc__select_columns(orc__reader_t *reader, PyObject *columns) {
+  if (columns == Py_None) {
+    return 0;
+  }
+
+  uint64_t *indexes;
+  Py_ssize_t n;
+  if (orc__column_indexes(reader->arena, columns, &indexes, &n) != 0) {
+    return -1;
+  }
+  if (orc__reader__select_columns(reader, indexes, n) != ORC__OK) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  return 0;
+}
+
+/* Strings of the footer and metadata may be views without a NUL terminator, None stands for a missing one */
+static PyObject *orc__string(orc__reader_t *reader, const char *value) {
+  if (value == NULL) {
+    Py_RETURN_NONE;
+  }
+  return PyString_FromStringAndSize(value, orc__reader__string_length(reader, value));
+}
+
+/* Decode a reader for read_metadata and the JSON functions, along with the statistics of the stripes in
+ * stripe_range which are then start+n*step for n below stripe_count. Returns -1 with an error set, and with the
+ * reader released, when stripe_range is not valid. Decoding errors are left in decode_status. */
+static int orc__decode_metadata(orc__reader_t *reader, int enable_schema, int enable_file_stats,
+                                int enable_stripe_stats, int decompress_threads, PyObject *stripe_range,
+                                Py_ssize_t *start, Py_ssize_t *step, Py_ssize_t *stripe_count, int *decode_status) {
+
+  if (stripe_range != Py_None && !PySlice_Check(stripe_range)) {
+    orc__reader__free(reader);
+    PyErr_SetString(PyExc_TypeError, "stripe_range must be a slice.");
+    return -1;
+  }
+
+  /* Decode ORC file, the footer types and statistics are only unpacked when they are part of the output.
+   * Everything the reader touches belongs to it, so other threads can run Python code meanwhile. */
+  reader->enable_schema = enable_schema;
+  reader->enable_file_stats = enable_file_stats;
+  reader->decompress_threads = decompress_threads;
+  reader->string_views = 1;
+  Py_BEGIN_ALLOW_THREADS
+  *decode_status = orc__reader__decode(reader);
+  Py_END_ALLOW_THREADS
+
+  /* Only the stripes in stripe_range have their statistics decoded */
+  Py_ssize_t n, stop;
+  *start = 0;
+  *step = 1;
+  *stripe_count = 0;
+  if (*decode_status == ORC__OK && enable_stripe_stats) {
+    *stripe_count = reader->metadata->n_stripestats;
+    if (stripe_range != Py_None && 
+        PySlice_GetIndicesEx(ORC__SLICE(stripe_range), *stripe_count, start, &stop, step, stripe_count) != 0) {
+      orc__reader__free(reader);
+      return -1;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    for (n=0; n < *stripe_count && *decode_status == ORC__OK; ++n) {
+      *decode_status = orc__reader__decode_stripe_statistics(reader, *start+n*(*step));
+    }
+    Py_END_ALLOW_THREADS
+  }
+  return 0;
+}
+
+static PyObject *orc__read_metadata(orc__reader_t *reader, int enable_schema, int enable_file_stats,
+                                    int enable_stripe_stats, int enable_stripes, int decompress_threads,
+                                    PyObject *stripe_range, int records) {
+  Py_ssize_t start, step, stripe_count;
+  int decode_status;
+  if (orc__decode_metadata(reader, enable_schema, enable_file_stats, enable_stripe_stats, decompress_threads,
+                           stripe_range, &start, &step, &stripe_count, &decode_status) != 0) {
+    return NULL;
+  }
+  return orc__build_metadata(reader, decode_status, enable_schema, enable_file_stats, enable_stripe_stats,
+                             enable_stripes, start, step, stripe_count, records);
+}
+
+/* Write the metadata of a reader as JSON straight from the decoded footer, without building the dict first.
+ * The output is returned as bytes, or written to the file descriptor of output when it is given, in which case
+ * output is flushed first so that what was written to it through Python comes before. ndjson writes the whole
+ * document on one line followed by a newline. The reader is released either way. */
+static PyObject *orc__write_json(orc__reader_t *reader, int enable_schema, int enable_file_stats,
+                                 int enable_stripe_stats, int enable_stripes, int decompress_threads,
+                                 PyObject *stripe_range, int ndjson, PyObject *output) {
+  Py_ssize_t start, step, stripe_count;
+  int decode_status, fd = -1;
+  PyObject *ret;
+  if (orc__decode_metadata(reader, enable_schema, enable_file_stats, enable_stripe_stats, decompress_threads,
+                           stripe_range, &start, &step, &stripe_count, &decode_status) != 0) {
+    return NULL;
+  }
+  if (decode_status != ORC__OK) {
+    orc__reader__free(reader);
+    return orc__decode_error(decode_status);
+  }
+
+  if (output != Py_None) {
+    if (PyObject_HasAttrString(output, "flush")) {
+      if ((ret = PyObject_CallMethod(output, "flush", NULL)) == NULL) {
+        orc__reader__free(reader);
+        return NULL;
+      }
+      Py_DECREF(ret);
+    }
+    if ((fd = PyObject_AsFileDescriptor(output)) < 0) {
+      orc__reader__free(reader);
+      return NULL;
+    }
+  }
+
+  orc__json_t json;
+  if (orc__json__init(&json, fd, ndjson ? 0 : 4) != ORC__OK) {
+    orc__reader__free(reader);
+    return PyErr_NoMemory();
+  }
+  Py_BEGIN_ALLOW_THREADS
+  decode_status = orc__json__metadata(&json, reader, enable_schema, enable_file_stats, enable_stripe_stats,
+                                      enable_stripes, start, step, stripe_count);
+  if (ndjson) {
+    orc__json__write(&json, "\n", 1);
+  }
+  if (fd >= 0) {
+    orc__json__flush(&json);
+  }
+  Py_END_ALLOW_THREADS
+  orc__reader__free(reader);
+
+  if (decode_status != ORC__OK) {
+    ret = orc__decode_error(decode_status);
+  }
+  else if (json.error == ENOMEM) {
+    ret = PyErr_NoMemory();
+  }
+  else if (json.error != 0) {
+    errno = json.error;
+    ret = PyErr_SetFromErrno(PyExc_IOError);
+  }
+  else if (fd >= 0) {
+    Py_INCREF(Py_None);
+    ret = Py_None;
+  }
+  else {
+    ret = PyBytes_FromStringAndSize(json.data, json.length);
+  }
+  orc__json__free(&json);
+  return ret;
+}
+
+/* Object of an enum value from one of the tables filled by orc__init_module, None for values it has none for */
+static PyObject *orc__enum_name(PyObject **objects, size_t count, uint32_t value) {
+  PyObject *name = value < count && objects[value] != NULL ? objects[value] : Py_None;
+  Py_INCREF(name);
+  return name;
+}
+
+static PyObject *orc__build_compression(orc__reader_t *reader) {
+  return orc__enum_name(orc__compressions, ORC__COMPRESSION_KINDS, reader->post_script->compression);
+}
+
+static PyObject *orc__build_version(orc__reader_t *reader) {
+  uint32_t writer = reader->post_script->writerversion;
+  uint32_t major = reader->post_script->n_version > 0 ? reader->post_script->version[0] : 0;
+  uint32_t minor = reader->post_script->n_version > 1 ? reader->post_script->version[1] : 0;
+  if (writer >= ORC__WRITER_VERSIONS) {
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  if (major == 0 && minor >= ORC__FILE_VERSION_MINOR && minor < ORC__FILE_VERSION_MINOR+ORC__FILE_VERSIONS) {
+    return orc__enum_name(orc__versions[minor-ORC__FILE_VERSION_MINOR], ORC__WRITER_VERSIONS, writer);
+  }
+  return PyString_FromFormat("%i.%i with %s", major, minor, orc__writer_version_names[writer]);
+}
+
+/* Schema string of the footer types, which must have been decoded. Schemas are memoized by the bytes of the types
+ * they are rendered from, as files written by the same job share them. */
+static PyObject *orc__build_schema_string(orc__reader_t *reader) {
+  orc__field_range_t *range = &reader->footer_fields[ORC__FOOTER_FIELD__TYPES];
+  PyObject *key, *value;
+  if ((key = PyBytes_FromStringAndSize((char *) range->start, range->end-range->start)) == NULL) {
+    return NULL;
+  }
+  if ((value = PyDict_GetItem(orc__schema_cache, key)) != NULL) {
+    Py_DECREF(key);
+    Py_INCREF(value);
+    return value;
+  }
+
+  int status;
+  char *schema;
+  size_t length;
+  if ((status = orc__schema__build(reader, &schema, &length)) != ORC__OK) {
+    Py_DECREF(key);
+    return orc__decode_error(status);
+  }
+  if ((value = PyString_FromStringAndSize(schema, length)) == NULL) {
+    Py_DECREF(key);
+    return NULL;
+  }
+
+  if (PyDict_Size(orc__schema_cache) >= ORC__SCHEMA_CACHE_SIZE) {
+    PyDict_Clear(orc__schema_cache);
+  }
+  if (PyDict_SetItem(orc__schema_cache, key, value) != 0) {
+    PyErr_Clear();
+  }
+  Py_DECREF(key);
+  return value;
+}
+
+/* Records returned instead of dicts with records=True, whose fields are in the order of the keys of the dicts.
+ * Fields a dict leaves out are None. */
+#define ORC__COLUMN_STATS_FIELDS  6
+#define ORC__STREAM_INFO_FIELDS   4
+#define ORC__ENCODING_INFO_FIELDS 2
+
+static PyStructSequence_Field orc__column_stats_fields[] = {
+  {"column", "Column index."},
+  {"has_null", "Whether the column holds nulls."},
+  {"count", "Number of values."},
+  {"min", "Minimum, None when not known or not recorded for the type."},
+  {"max", "Maximum, None when not known or not recorded for the type."},
+  {"sum", "Sum, None when not known or not recorded for the type."},
+  {NULL, NULL}
+};
+
+static PyStructSequence_Field orc__stream_info_fields[] = {
+  {"section", "Stream kind."},
+  {"column", "Column index."},
+  {"start", "Offset of the stream in the file."},
+  {"length", "Length of the stream."},
+  {NULL, NULL}
+};
+
+static PyStructSequence_Field orc__encoding_info_fields[] = {
+  {"encoding", "Column encoding, along with the dictionary size of dictionary encodings."},
+  {"column", "Column index."},
+  {NULL, NULL}
+};
+
+static PyStructSequence_Desc orc__column_stats_desc = {
+  "_orc_metadata.ColumnStats", "Statistics of a column in a file or stripe.", orc__column_stats_fields,
+  ORC__COLUMN_STATS_FIELDS
+};
+
+static PyStructSequence_Desc orc__stream_info_desc = {
+  "_orc_metadata.StreamInfo", "Stream of a stripe.", orc__stream_info_fields, ORC__STREAM_INFO_FIELDS
+};
+
+static PyStructSequence_Desc orc__encoding_info_desc = {
+  "_orc_metadata.EncodingInfo", "Encoding of a column in a stripe.", orc__encoding_info_fields,
+  ORC__ENCODING_INFO_FIELDS
+};
+
+static const int orc__column_stats_keys[ORC__COLUMN_STATS_FIELDS] = {
+  ORC__KEY__COLUMN, ORC__KEY__HAS_NULL, ORC__KEY__COUNT, ORC__KEY__MIN, ORC__KEY__MAX, ORC__KEY__SUM
+};
+static const int orc__stream_info_keys[ORC__STREAM_INFO_FIELDS] = {
+  ORC__KEY__SECTION, ORC__KEY__COLUMN, ORC__KEY__START, ORC__KEY__LENGTH
+};
+static const int orc__encoding_info_keys[ORC__ENCODING_INFO_FIELDS] = {
+  ORC__KEY__ENCODING, ORC__KEY__COLUMN
+};
+
+static PyTypeObject orc__column_stats_type;
+static PyTypeObject orc__stream_info_type;
+static PyTypeObject orc__encoding_info_type;
+
+/* Record of n values as a record of type with records set, or else as a dict keyed by keys. The values are
+ * stolen, NULL values are None in records and left out of dicts. Values which failed to build left an error
+ * set, and then NULL is returned. */
+static PyObject *orc__build_record(PyTypeObject *type, const int *keys, PyObject **values, int n, int records) {
+  PyObject *ret = NULL;
+  int i;
+  if (PyErr_Occurred() || (ret = records ? PyStructSequence_New(type) : PyDict_New()) == NULL) {
+    goto error;
+  }
+
+  for (i=0; i < n; ++i) {
+    if (records) {
+      if (values[i] == NULL) {
+        Py_INCREF(Py_None);
+        values[i] = Py_None;
+      }
+      PyStructSequence_SET_ITEM(ret, i, values[i]);
+      values[i] = NULL;
+    }
+    else if (values[i] != NULL) {
+      if (PyDict_SetItem(ret, orc__keys[keys[i]], values[i]) != 0) {
+        goto error;
+      }
+      Py_CLEAR(values[i]);
+    }
+  }
+  return ret;
+
+error:
+  Py_XDECREF(ret);
+  for (i=0; i < n; ++i) {
+    Py_XDECREF(values[i]);
+  }
+  return NULL;
+}
+
+/* Statistics of unselected columns were not decoded and are left out, the others keep their column index */
+static PyObject *orc__build_column_statistics(orc__reader_t *reader, Orc__Proto__ColumnStatistics **statistics,
+                                              size_t n, int records) {
+  size_t i, k;
+  PyObject *ptr, *col_stats;
+  PyObject *values[ORC__COLUMN_STATS_FIELDS];
+  col_stats = PyList_New(orc__reader__selected_columns(reader, n));
+  Py_MEMCHECK(col_stats);
+  for (i=0, k=0; i < n; ++i) {
+    if (statistics[i] == NULL) {
+      continue;
+    }
+    values[0] = Py_BuildValue("n", (Py_ssize_t) i);
+    values[1] = PyBool_FromLong(statistics[i]->hasnull);
+    values[2] = Py_BuildValue("K", statistics[i]->numberofvalues);
+    values[3] = values[4] = values[5] = NULL;
+
+    if (statistics[i]->intstatistics != NULL) {
+      if (statistics[i]->intstatistics->has_minimum) {
+        values[3] = Py_BuildValue("L", statistics[i]->intstatistics->minimum);
+      }
+      if (statistics[i]->intstatistics->has_maximum) {
+        values[4] = Py_BuildValue("L", statistics[i]->intstatistics->maximum);
+      }
+      if (statistics[i]->intstatistics->has_sum) {
+        values[5] = Py_BuildValue("L", statistics[i]->intstatistics->sum);
+      }
+    }
+    else if (statistics[i]->doublestatistics != NULL) {
+      if (statistics[i]->doublestatistics->has_minimum) {
+        values[3] = Py_BuildValue("d", statistics[i]->doublestatistics->minimum);
+      }
+      if (statistics[i]->doublestatistics->has_maximum) {
+        values[4] = Py_BuildValue("d", statistics[i]->doublestatistics->maximum);
+      }
+      if (statistics[i]->doublestatistics->has_sum) {
+        values[5] = Py_BuildValue("d", statistics[i]->doublestatistics->sum);
+      }
+    }
+    else if (statistics[i]->stringstatistics != NULL) {
+      values[3] = orc__string(reader, statistics[i]->stringstatistics->minimum);
+      values[4] = orc__string(reader, statistics[i]->stringstatistics->maximum);
+      if (statistics[i]->stringstatistics->has_sum) {
+        values[5] = Py_BuildValue("L", statistics[i]->stringstatistics->sum);
+      }
+    }
+    else if (statistics[i]->decimalstatistics != NULL) {
+      values[3] = orc__string(reader, statistics[i]->decimalstatistics->minimum);
+      values[4] = orc__string(reader, statistics[i]->decimalstatistics->maximum);
+      values[5] = orc__string(reader, statistics[i]->decimalstatistics->sum);
+    }
+    else if (statistics[i]->datestatistics != NULL) {
+      if (statistics[i]->datestatistics->has_minimum) {
+        values[3] = Py_BuildValue("i", statistics[i]->datestatistics->minimum);
+      }
+      if (statistics[i]->datestatistics->has_maximum) {
+        values[4] = Py_BuildValue("i", statistics[i]->datestatistics->maximum);
+      }
+    }
+
+    if ((ptr = orc__build_record(&orc__column_stats_type, orc__column_stats_keys, values,
+                                 ORC__COLUMN_STATS_FIELDS, records)) == NULL) {
+      Py_DECREF(col_stats);
+      return NULL;
+    }
+    PyList_SET_ITEM(col_stats, k++, ptr);
+  }
+  return col_stats;
+}
+
+/* Statistics of stripe i, which must have been decoded */
+static PyObject *orc__build_stripe_statistics(orc__reader_t *reader, size_t i, int records) {
+  PyObject *value, *col_stats, *stripe_stat_section;
+  stripe_stat_section = PyDict_New();
+  Py_MEMCHECK(stripe_stat_section);
+
+  col_stats = orc__build_column_statistics(reader, reader->metadata->stripestats[i]->colstats,
+                                           reader->metadata->stripestats[i]->n_colstats, records);
+  if (col_stats == NULL) {
+    Py_DECREF(stripe_stat_section);
+    return NULL;
+  }
+
+  value = Py_BuildValue("n", (Py_ssize_t) i);
+  Py_MEMCHECK(value);
+  PyDict_SetItem(stripe_stat_section, ORC__KEY(STRIPE), value);
+  Py_DECREF(value);
+
+  PyDict_SetItem(stripe_stat_section, ORC__KEY(STATISTICS), col_stats);
+  Py_DECREF(col_stats);
+  return stripe_stat_section;
+}
+
+/* Stripe i along with its footer, which must have been decoded */
+static PyObject *orc__build_stripe(orc__reader_t *reader, size_t i, int records) {
+  size_t j;
+  int64_t stream_offset;
+  PyObject *value, *stripe, *stream, *encoding_col;
+  PyObject *stream_list, *encoding_list;
+  PyObject *stream_values[ORC__STREAM_INFO_FIELDS];
+  PyObject *encoding_values[ORC__ENCODING_INFO_FIELDS];
+  Orc__Proto__StripeFooter *footer = reader->stripe_footers[i];
+
+  stripe = PyDict_New();
+  Py_MEMCHECK(stripe);
+
+  value = Py_BuildValue("n", (Py_ssize_t) i);
+  Py_MEMCHECK(value);
+  PyDict_SetItem(stripe, ORC__KEY(STRIPE), value);
+  Py_DECREF(value);
+
+  value = Py_BuildValue("K", reader->footer->stripes[i]->offset);  
+  Py_MEMCHECK(value);
+  PyDict_SetItem(stripe, ORC__KEY(OFFSET), value);
+  Py_DECREF(value);
+
+  value = Py_BuildValue("K", reader->footer->stripes[i]->datalength);  
+  Py_MEMCHECK(value);
+  PyDict_SetItem(stripe, ORC__KEY(DATA), value);
+  Py_DECREF(value);
+
+  value = Py_BuildValue("K", reader->footer->stripes[i]->numberofrows);  
+  Py_MEMCHECK(value);
+  PyDict_SetItem(stripe, ORC__KEY(ROWS), value);
+  Py_DECREF(value);
+
+  value = Py_BuildValue("K", reader->footer->stripes[i]->footerlength);
+  Py_MEMCHECK(value);
+  PyDict_SetItem(stripe, ORC__KEY(TAIL), value);
+  Py_DECREF(value);
+
+  value = Py_BuildValue("K", reader->footer->stripes[i]->indexlength);
+  Py_MEMCHECK(value);
+  PyDict_SetItem(stripe, ORC__KEY(INDEX), value);
+  Py_DECREF(value);
+
+  stream_offset = reader->footer->stripes[i]->offset;
+  stream_list = PyList_New(footer->n_streams);
+  Py_MEMCHECK(stream_list);
+  for (j=0; j < footer->n_streams; ++j) { 
+    stream_values[0] = orc__enum_name(orc__stream_kinds, ORC__STREAM_KINDS, footer->streams[j]->kind);
+    stream_values[1] = Py_BuildValue("I", footer->streams[j]->column);
+    stream_values[2] = Py_BuildValue("L", stream_offset);
+    stream_values[3] = Py_BuildValue("K", footer->streams[j]->length);
+    if ((stream = orc__build_record(&orc__stream_info_type, orc__stream_info_keys, stream_values,
+                                    ORC__STREAM_INFO_FIELDS, records)) == NULL) {
+      Py_DECREF(stream_list);
+      Py_DECREF(stripe);
+      return NULL;
+    }
+    PyList_SET_ITEM(stream_list, j, stream);
+
+    stream_offset += footer->streams[j]->length;
+  }
+
+  encoding_list = PyList_New(footer->n_columns); 
+  Py_MEMCHECK(encoding_list);
+  for (j=0; j < footer->n_columns; ++j) {
+    if (footer->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DICTIONARY) {
+      encoding_values[0] = PyString_FromFormat("DICTIONARY[%u]", footer->columns[j]->dictionarysize);
+    }
+    else if (footer->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DICTIONARY_V2) {
+      encoding_values[0] = PyString_FromFormat("DICTIONARY_V2[%u]", footer->columns[j]->dictionarysize);
+    }
+    else {
+      encoding_values[0] = orc__enum_name(orc__encodings, ORC__ENCODING_KINDS, footer->columns[j]->kind);
+    }
+    encoding_values[1] = Py_BuildValue("n", (Py_ssize_t) j);
+    if ((encoding_col = orc__build_record(&orc__encoding_info_type, orc__encoding_info_keys, encoding_values,
+                                          ORC__ENCODING_INFO_FIELDS, records)) == NULL) {
+      Py_DECREF(encoding_list);
+      Py_DECREF(stream_list);
+      Py_DECREF(stripe);
+      return NULL;
+    }
+    PyList_SET_ITEM(encoding_list, j, encoding_col);
+  }
+
+  PyDict_SetItem(stripe, ORC__KEY(STREAMS), stream_list);
+  Py_DECREF(stream_list);
+
+  PyDict_SetItem(stripe, ORC__KEY(ENCODINGS), encoding_list);
+  Py_DECREF(encoding_list);
+
+  return stripe;
+}
+
+/* Raise the error decoding failed with */
+static PyObject *orc__decode_error(int decode_status) {
+  if (decode_status == ORC__ENOMEM) {
+    return PyErr_NoMemory();
+  }
+
+  if (decode_status == ORC__DECOMPRESS_ERR) {
+    PyErr_SetString(ORCReadException, "Could not decompress file.");
+    return NULL;
+  }
+
+  if (decode_status == ORC__NOSTREAM) {
+    PyErr_SetString(ORCReadException, "Could not read partial file.");
+    return NULL;
+  }
+
+  PyErr_SetString(ORCReadException, "Could not decode file.");
+  return NULL;
+}
+
+/* Turn a decoded reader into the metadata dict, or raise the error decoding it failed with. The statistics
+ * of the stripes start+n*step for n below stripe_count are included, column statistics, streams and encodings
+ * are records when records is set. The reader is released either way. */
+static PyObject *orc__build_metadata(orc__reader_t *reader, int decode_status, int enable_schema,
+                                     int enable_file_stats, int enable_stripe_stats, int enable_stripes,
+                                     Py_ssize_t start, Py_ssize_t step, Py_ssize_t stripe_count, int records) {  if (decode_status != ORC__OK) {
+    orc__reader__free(reader);
+    return orc__decode_error(decode_status);
+  }
+  size_t i;
+  Py_ssize_t n;
+  PyObject *value, *list = NULL, *ret = PyDict_New();
+  if (ret == NULL) {
+    goto error;
+  }
+
+
+  /* Encode metadata as PyObject */
+
+  if ((value = Py_BuildValue("K", reader->footer->numberofrows)) == NULL) {
+    goto error;
+  }
+  PyDict_SetItem(ret, ORC__KEY(ROWS), value);
+  Py_DECREF(value);
+
+  if ((value = orc__build_compression(reader)) == NULL) {
+    goto error;
+  }
+  PyDict_SetItem(ret, ORC__KEY(COMPRESSION), value);
+  Py_DECREF(value);
+
+  if ((value = orc__build_version(reader)) == NULL) {
+    goto error;
+  }
+  PyDict_SetItem(ret, ORC__KEY(VERSION), value);
+  Py_DECREF(value);
+
+  if ((value = Py_BuildValue("K", reader->post_script->compressionblocksize)) == NULL) {
+    goto error;
+  }
+  PyDict_SetItem(ret, ORC__KEY(COMPRESSION_SIZE), value);
+  Py_DECREF(value);
+
+
+  /* Build schema */
+  if (enable_schema) {
+    if ((value = orc__build_schema_string(reader)) == NULL) {
+      goto error;
+    }
+    PyDict_SetItem(ret, ORC__KEY(SCHEMA), value);
+    Py_DECREF(value);
+  }
+
+
+  /* Build Stripe Statistics */
+  if (enable_stripe_stats) {
+    if ((list = PyList_New(stripe_count)) == NULL) {
+      goto error;
+    }
+    for (n=0; n < stripe_count; ++n) {
+      if ((value = orc__build_stripe_statistics(reader, start+n*step, records)) == NULL) {
+        goto error;
+      }
+      PyList_SetItem(list, n, value);
+    }
+
+    PyDict_SetItem(ret, ORC__KEY(STRIPE_STATISTICS), list);
+    Py_CLEAR(list);
+  }
+
+  /* Build File Statistics */
+  if (enable_file_stats) {
+    value = orc__build_column_statistics(reader, reader->footer->statistics, reader->footer->n_statistics,
+                                         records);
+    if (value == NULL) {
+      goto error;
+    }
+    PyDict_SetItem(ret, ORC__KEY(FILE_STATISTICS), value);
+    Py_DECREF(value);
+  }
+
+  /* Build Stripe Footers */
+  if (enable_stripes) {
+    if ((list = PyList_New(reader->footer->n_stripes)) == NULL) {
+      goto error;
+    }
+    for (i=0; i < reader->footer->n_stripes; ++i) {
+      if ((value = orc__build_stripe(reader, i, records)) == NULL) {
+        goto error;
+      }
+      PyList_SetItem(list, i, value);
+    }
+
+    PyDict_SetItem(ret, ORC__KEY(STRIPES), list);
+    Py_CLEAR(list);
+  }
+
+  orc__reader__free(reader);
+  return ret;
+
+error:
+  /* The builders return NULL without an exception set when they run out of memory */
+  if (!PyErr_Occurred()) {
+    PyErr_NoMemory();
+  }
+  Py_XDECREF(list);
+  Py_XDECREF(ret);
+  orc__reader__free(reader);
+  return NULL;
+}
+
+/* Flat array of numbers exported through the buffer protocol, so that numpy and the like can wrap it without
+ * a copy. Bitmaps are arrays of bytes. */
+typedef struct orc__array_t {
+  PyObject_HEAD
+  void *data;
+  Py_ssize_t length;
+  Py_ssize_t itemsize;
+  char *format;
+} orc__array_t;
+
+static PyTypeObject orc__array_type;
+
+static PyObject *orc__array__new(char *format, Py_ssize_t itemsize, Py_ssize_t length) {
+  orc__array_t *self;
+  if ((self = PyObject_New(orc__array_t, &orc__array_type)) == NULL) {
+    return NULL;
+  }
+  self->length = length;
+  self->itemsize = itemsize;
+  self->format = format;
+  if ((self->data = PyMem_Malloc(length > 0 ? length*itemsize : 1)) == NULL) {
+    Py_DECREF(self);
+    return PyErr_NoMemory();
+  }
+  return (PyObject *) self;
+}
+
+static void orc__array__dealloc(orc__array_t *self) {
+  PyMem_Free(self->data);
+  PyObject_Del(self);
+}
+
+static Py_ssize_t orc__array__length(orc__array_t *self) {
+  return self->length;
+}
+
+/* Consumers not asking for the format get the plain bytes */
+static int orc__array__getbuffer(orc__array_t *self, Py_buffer *view, int flags) {
+  if (PyBuffer_FillInfo(view, (PyObject *) self, self->data, self->length*self->itemsize, 1, flags) != 0) {
+    return -1;
+  }
+  if (flags & PyBUF_FORMAT) {
+    view->format = self->format;
+    view->itemsize = self->itemsize;
+    view->shape = (flags & PyBUF_ND) ? &self->length : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->itemsize : NULL;
+  }
+  return 0;
+}
+
+#if PY_MAJOR_VERSION < 3
+/* Python 2 consumers such as numpy.frombuffer still use the old buffer protocol */
+static Py_ssize_t orc__array__getreadbuffer(orc__array_t *self, Py_ssize_t segment, void **pointer) {
+  if (segment != 0) {
+    PyErr_SetString(PyExc_SystemError, "accessing non-existent array segment");
+    return -1;
+  }
+  *pointer = self->data;
+  return self->length*self->itemsize;
+}
+
+static Py_ssize_t orc__array__getsegcount(orc__array_t *self, Py_ssize_t *length) {
+  if (length != NULL) {
+    *length = self->length*self->itemsize;
+  }
+  return 1;
+}
+
+static PyBufferProcs orc__array_buffer = {
+  (readbufferproc) orc__array__getreadbuffer, NULL, (segcountproc) orc__array__getsegcount,
+  (charbufferproc) orc__array__getreadbuffer, (getbufferproc) orc__array__getbuffer, NULL
+};
+#define ORC__ARRAY_FLAGS  (Py_TPFLAGS_DEFAULT|Py_TPFLAGS_HAVE_NEWBUFFER)
+#else
+static PyBufferProcs orc__array_buffer = {
+  (getbufferproc) orc__array__getbuffer, NULL
+};
+#define ORC__ARRAY_FLAGS  Py_TPFLAGS_DEFAULT
+#endif
+
+static PySequenceMethods orc__array_sequence = {
+  (lenfunc) orc__array__length
+};
+
+static PyTypeObject orc__array_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "_orc_metadata.StatisticsArray",
+  .tp_basicsize = sizeof(orc__array_t),
+  .tp_dealloc = (destructor) orc__array__dealloc,
+  .tp_as_sequence = &orc__array_sequence,
+  .tp_as_buffer = &orc__array_buffer,
+  .tp_flags = ORC__ARRAY_FLAGS,
+  .tp_doc = "Read-only array of statistics, one entry per stripe, supporting the buffer protocol.",
+};
+
+/* Add a new array to the dict of a column, returning its data */
+static void *orc__array__add(PyObject *dict, PyObject *key, char *format, Py_ssize_t itemsize,
+                             Py_ssize_t length) {
+  PyObject *array;
+  if ((array = orc__array__new(format, itemsize, length)) == NULL) {
+    return NULL;
+  }
+  if (PyDict_SetItem(dict, key, array) != 0) {
+    Py_DECREF(array);
+    return NULL;
+  }
+  Py_DECREF(array);
+  return ((orc__array_t *) array)->data;
+}
+
+/* Statistics of a column, one entry of statistics per stripe, as a dict of arrays */
+static PyObject *orc__build_columnar_statistics(uint64_t column, Orc__Proto__ColumnStatistics **statistics,
+                                                Py_ssize_t count) {
+  orc__columnar_t output;
+  output.kind = orc__columnar__kind(statistics, count);
+
+  PyObject *value, *ret = PyDict_New();
+  Py_MEMCHECK(ret);
+
+  value = Py_BuildValue("n", (Py_ssize_t) column);
+  Py_MEMCHECK(value);
+  PyDict_SetItem(ret, ORC__KEY(COLUMN), value);
+  Py_DECREF(value);
+
+  char *format = output.kind == ORC__COLUMNAR_KIND__DOUBLE ? "d" : "q";
+  value = orc__enum_name(orc__columnar_kinds, ORC__COLUMNAR_KINDS, output.kind);
+  Py_MEMCHECK(value);
+  PyDict_SetItem(ret, ORC__KEY(KIND), value);
+  Py_DECREF(value);
+
+  Py_ssize_t bitmap_size = orc__columnar__bitmap_size(count);
+  if ((output.count = orc__array__add(ret, ORC__KEY(COUNT), "Q", sizeof(uint64_t), count)) == NULL ||
+      (output.has_null = orc__array__add(ret, ORC__KEY(HAS_NULL), "B", 1, bitmap_size)) == NULL) {
+    Py_DECREF(ret);
+    return NULL;
+  }
+  if (orc__columnar__numeric(output.kind) &&
+      ((output.has_bounds = orc__array__add(ret, ORC__KEY(HAS_BOUNDS), "B", 1, bitmap_size)) == NULL ||
+       (output.has_sum = orc__array__add(ret, ORC__KEY(HAS_SUM), "B", 1, bitmap_size)) == NULL ||
+       (output.minimum = orc__array__add(ret, ORC__KEY(MIN), format, sizeof(int64_t), count)) == NULL ||
+       (output.maximum = orc__array__add(ret, ORC__KEY(MAX), format, sizeof(int64_t), count)) == NULL ||
+       (output.sum = orc__array__add(ret, ORC__KEY(SUM), format, sizeof(int64_t), count)) == NULL)) {
+    Py_DECREF(ret);
+    return NULL;
+  }
+
+  orc__columnar__fill(statistics, count, &output);
+  return ret;
+}
+
+/* Metadata of one file as returned by open_metadata, which keeps the decoded footer and only decodes and builds
+ * each part on first access. Lazy decoding happens with the GIL held, so one object may be shared between
+ * threads. Stripe footers are read as they are accessed, so the file stays open or mapped until close. */
+typedef struct orc__metadata_t {
+  PyObject_HEAD
+  orc__reader_t *reader;
+
+  /* Memory the reader of open_metadata_buffer borrows, released along with the reader */
+  Py_buffer input;
+  int has_input;
+
+  /* Whether column statistics, streams and encodings are built as records */
+  int records;
+
+  /* Parts built so far, stripe statistics and stripes are cached in dicts keyed by stripe index */
+  PyObject *schema;
+  PyObject *file_stats;
+  PyObject *stripe_stats;
+  PyObject *stripes;
+} orc__metadata_t;
+
+static PyTypeObject orc__metadata_type;
+
+/* Decode the footer of a new reader and wrap it, the reader and input are released if that fails */
+static PyObject *orc__metadata__new(orc__reader_t *reader, Py_buffer *input, int decompress_threads,
+                                    PyObject *columns, int records) {
+  int status = ORC__OK;
+  if (orc__select_columns(reader, columns) != 0) {
+    status = -1;
+  }
+  else {
+    reader->decompress_threads = decompress_threads;
+    reader->string_views = 1;
+    Py_BEGIN_ALLOW_THREADS
+    status = orc__reader__decode_footer(reader);
+    Py_END_ALLOW_THREADS
+    if (status != ORC__OK) {
+      orc__decode_error(status);
+    }
+  }
+
+  orc__metadata_t *self = NULL;
+  if (status == ORC__OK && (self = PyObject_New(orc__metadata_t, &orc__metadata_type)) == NULL) {
+    PyErr_NoMemory();
+  }
+  if (self == NULL) {
+    orc__reader__free(reader);
+    if (input != NULL) {
+      PyBuffer_Release(input);
+    }
+    return NULL;
+  }
+
+  self->reader = reader;
+  self->has_input = input != NULL;
+  if (input != NULL) {
+    self->input = *input;
+  }
+  self->records = records;
+  self->schema = NULL;
+  self->file_stats = NULL;
+  self->stripe_stats = NULL;
+  self->stripes = NULL;
+  return (PyObject *) self;
+}
 
-void orc__build_schema(PyObject **output, Orc__Proto__Type **types, Orc__Proto__Type *type);
+/* Release the reader along with its file or buffer, and the parts built so far */
+static void orc__metadata__release(orc__metadata_t *self) {
+  Py_CLEAR(self->schema);
+  Py_CLEAR(self->file_stats);
+  Py_CLEAR(self->stripe_stats);
+  Py_CLEAR(self->stripes);
+  if (self->reader != NULL) {
+    orc__reader__free(self->reader);
+    self->reader = NULL;
+  }
+  if (self->has_input) {
+    PyBuffer_Release(&self->input);
+    self->has_input = 0;
+  }
+}
 
-static PyObject *read_metadata(PyObject *self, PyObject *args, PyObject *kwargs) {
+static void orc__metadata__dealloc(orc__metadata_t *self) {
+  orc__metadata__release(self);
+  PyObject_Del(self);
+}
 
-  const char *input_path;
-  int enable_schema = 0;
-  int enable_file_stats = 0;
-  int enable_stripe_stats = 0;
-  int enable_stripes = 0;
-  static char *kwlist[] = {"input_path", "schema", "file_stats", "stripe_stats", "stripes", NULL};
+/* Raise ValueError when the metadata was closed, as files do */
+static int orc__metadata__check_open(orc__metadata_t *self) {
+  if (self->reader == NULL) {
+    PyErr_SetString(PyExc_ValueError, "I/O operation on closed metadata.");
+    return -1;
+  }
+  return 0;
+}
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|iiii", kwlist, &input_path, &enable_schema,
-                                   &enable_file_stats, &enable_stripe_stats, &enable_stripes)) {
-    PyErr_BadArgument();
+static PyObject *orc__metadata__close(orc__metadata_t *self, PyObject *unused) {
+  orc__metadata__release(self);
+  Py_RETURN_NONE;
+}
+
+static PyObject *orc__metadata__enter(orc__metadata_t *self, PyObject *unused) {
+  if (orc__metadata__check_open(self) != 0) {
     return NULL;
   }
+  Py_INCREF(self);
+  return (PyObject *) self;
+}
+
+static PyObject *orc__metadata__exit(orc__metadata_t *self, PyObject *args) {
+  orc__metadata__release(self);
+  Py_RETURN_FALSE;
+}
+
+static PyObject *orc__metadata__get_closed(orc__metadata_t *self, void *closure) {
+  return PyBool_FromLong(self->reader == NULL);
+}
+
+/* Resolve a possibly negative index against length, raising IndexError when it is out of range */
+static int orc__metadata__index(Py_ssize_t *i, Py_ssize_t length) {
+  if (*i < 0) {
+    *i += length;
+  }
+  if (*i < 0 || *i >= length) {
+    PyErr_SetString(PyExc_IndexError, "stripe index out of range");
+    return -1;
+  }
+  return 0;
+}
 
-  /* Initialize reader */
-  orc__reader_t *reader;
-  if ((reader = orc__reader__init(input_path, enable_stripe_stats, enable_stripes)) == NULL) {
-    PyErr_SetFromErrno(PyExc_OSError);
+/* Entry i of one of the per stripe caches, built by build on a miss. New reference. */
+static PyObject *orc__metadata__cached(PyObject **cache, Py_ssize_t i, orc__reader_t *reader, int records,
+                                       PyObject *(*build)(orc__reader_t *, size_t, int)) {
+  if (*cache == NULL && (*cache = PyDict_New()) == NULL) {
     return NULL;
   }
 
-  /* Decode ORC file */
-  int decode_status;
-  if ((decode_status = orc__reader__decode(reader)) != ORC__OK) {
-    orc__reader__free(reader);
+  PyObject *key, *value;
+  if ((key = PyInt_FromSsize_t(i)) == NULL) {
+    return NULL;
+  }
+  if ((value = PyDict_GetItem(*cache, key)) != NULL) {
+    Py_DECREF(key);
+    Py_INCREF(value);
+    return value;
+  }
 
-    if (decode_status == ORC__ENOMEM) {
-      return PyErr_NoMemory();
-    }
+  if ((value = build(reader, i, records)) == NULL || PyDict_SetItem(*cache, key, value) != 0) {
+    Py_DECREF(key);
+    Py_XDECREF(value);
+    return NULL;
+  }
+  Py_DECREF(key);
+  return value;
+}
+
+static PyObject *orc__metadata__get_rows(orc__metadata_t *self, void *closure) {
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
+  return Py_BuildValue("K", self->reader->footer->numberofrows);
+}
+
+static PyObject *orc__metadata__get_compression(orc__metadata_t *self, void *closure) {
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
+  return orc__build_compression(self->reader);
+}
+
+static PyObject *orc__metadata__get_version(orc__metadata_t *self, void *closure) {
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
+  return orc__build_version(self->reader);
+}
+
+static PyObject *orc__metadata__get_compression_size(orc__metadata_t *self, void *closure) {
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
+  return Py_BuildValue("K", self->reader->post_script->compressionblocksize);
+}
+
+static PyObject *orc__metadata__get_n_stripes(orc__metadata_t *self, void *closure) {
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
+  return Py_BuildValue("n", (Py_ssize_t) self->reader->footer_fields[ORC__FOOTER_FIELD__STRIPES].count);
+}
 
-    if (decode_status == ORC__DECOMPRESS_ERR) {
-      PyErr_SetString(ORCReadException, "Could not decompress file.");
+static PyObject *orc__metadata__get_schema(orc__metadata_t *self, void *closure) {
+  int status;
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
+  if (self->schema == NULL) {
+    if ((status = orc__reader__decode_footer_field(self->reader, ORC__FOOTER_FIELD__TYPES)) != ORC__OK) {
+      return orc__decode_error(status);
+    }
+    if ((self->schema = orc__build_schema_string(self->reader)) == NULL) {
       return NULL;
     }
+  }
+  Py_INCREF(self->schema);
+  return self->schema;
+}
 
-    if (decode_status == ORC__NOSTREAM) {
-      PyErr_SetString(ORCReadException, "Could not read partial file.");
+static PyObject *orc__metadata__get_file_stats(orc__metadata_t *self, void *closure) {
+  int status;
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
+  if (self->file_stats == NULL) {
+    if ((status = orc__reader__decode_footer_field(self->reader, ORC__FOOTER_FIELD__STATISTICS)) != ORC__OK) {
+      return orc__decode_error(status);
+    }
+    if ((self->file_stats = orc__build_column_statistics(self->reader, self->reader->footer->statistics,
+                                                         self->reader->footer->n_statistics,
+                                                         self->records)) == NULL) {
       return NULL;
     }
   }
-  int i, j;
-  PyObject *value, *ret = PyDict_New();
-  Py_MEMCHECK(ret);
+  Py_INCREF(self->file_stats);
+  return self->file_stats;
+}
 
+static PyObject *orc__metadata__stripe_stats(orc__metadata_t *self, PyObject *args) {
+  Py_ssize_t i;
+  if (!PyArg_ParseTuple(args, "n", &i)) {
+    return NULL;
+  }
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
 
-  /* Encode metadata as PyObject */
+  int status;
+  if ((status = orc__reader__decode_metadata(self->reader)) != ORC__OK) {
+    return orc__decode_error(status);
+  }
+  if (orc__metadata__index(&i, self->reader->metadata->n_stripestats) != 0) {
+    return NULL;
+  }
+  if ((status = orc__reader__decode_stripe_statistics(self->reader, i)) != ORC__OK) {
+    return orc__decode_error(status);
+  }
+  return orc__metadata__cached(&self->stripe_stats, i, self->reader, self->records,
+                               orc__build_stripe_statistics);
+}
 
-  value = Py_BuildValue("K", reader->footer->numberofrows);
-  Py_MEMCHECK(value);
+static PyObject *orc__metadata__stripe(orc__metadata_t *self, PyObject *args) {
+  Py_ssize_t i;
+  if (!PyArg_ParseTuple(args, "n", &i)) {
+    return NULL;
+  }
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
 
-  PyDict_SetItemString(ret, "rows", value);
-  Py_DECREF(value);
-  
-  if (reader->post_script->compression == ORC__COMPRESSION_KIND__NONE) {
-    value = PyString_FromString("NONE"); 
+  int status;
+  if ((status = orc__reader__decode_footer_field(self->reader, ORC__FOOTER_FIELD__STRIPES)) != ORC__OK) {
+    return orc__decode_error(status);
   }
-  if (reader->post_script->compression == ORC__COMPRESSION_KIND__ZLIB) {
-    value = PyString_FromString("ZLIB");
+  if (orc__metadata__index(&i, self->reader->footer->n_stripes) != 0) {
+    return NULL;
   }
-  if (reader->post_script->compression == ORC__COMPRESSION_KIND__SNAPPY) {
-    value = PyString_FromString("SNAPPY");
+  if ((status = orc__reader__decode_stripe_footer(self->reader, i)) != ORC__OK) {
+    return orc__decode_error(status);
   }
-  if (reader->post_script->compression == ORC__COMPRESSION_KIND__LZO) {
-    value = PyString_FromString("LZO");
+  return orc__metadata__cached(&self->stripes, i, self->reader, self->records, orc__build_stripe);
+}
+
+static PyObject *orc__metadata__column_stats(orc__metadata_t *self, PyObject *args, PyObject *kwargs) {
+  PyObject *columns;
+  PyObject *stripe_range = Py_None;
+  static char *kwlist[] = {"columns", "stripe_range", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &columns, &stripe_range)) {
+    return NULL;
   }
-  if (reader->post_script->compression == ORC__COMPRESSION_KIND__LZ4) {
-    value = PyString_FromString("LZ4");
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
   }
-  if (reader->post_script->compression == ORC__COMPRESSION_KIND__ZSTD) {
-    value = PyString_FromString("ZSTD");
+  if (stripe_range != Py_None && !PySlice_Check(stripe_range)) {
+    PyErr_SetString(PyExc_TypeError, "stripe_range must be a slice.");
+    return NULL;
   }
-  Py_MEMCHECK(value);
-  PyDict_SetItemString(ret, "compression", value);
-  Py_DECREF(value);
 
-  if (reader->post_script->writerversion == 0) {
-    value = PyString_FromFormat("%i.%i with original", reader->post_script->version[0], reader->post_script->version[1]);
+  uint64_t *indexes;
+  Py_ssize_t n_indexes;
+  if (orc__column_indexes(NULL, columns, &indexes, &n_indexes) != 0) {
+    return NULL;
   }
-  if (reader->post_script->writerversion == 1) {
-    value = PyString_FromFormat("%i.%i with HIVE-8732", reader->post_script->version[0], reader->post_script->version[1]);
+
+  int status;
+  PyObject *value, *ret = NULL;
+  Orc__Proto__ColumnStatistics **statistics = NULL;
+  if ((status = orc__reader__decode_metadata(self->reader)) != ORC__OK) {
+    orc__decode_error(status);
+    goto done;
   }
-  if (reader->post_script->writerversion == 2) {
-    value = PyString_FromFormat("%i.%i with HIVE-4243", reader->post_script->version[0], reader->post_script->version[1]);
+
+  Py_ssize_t n, start = 0, stop, step = 1, stripe_count = self->reader->metadata->n_stripestats;
+  if (stripe_range != Py_None &&
+      PySlice_GetIndicesEx(ORC__SLICE(stripe_range), stripe_count, &start, &stop, &step, &stripe_count) != 0) {
+    goto done;
   }
-  if (reader->post_script->writerversion == 3) {
-    value = PyString_FromFormat("%i.%i with HIVE-12055", reader->post_script->version[0], reader->post_script->version[1]);
+  for (n=0; n < stripe_count; ++n) {
+    if ((status = orc__reader__decode_stripe_statistics(self->reader, start+n*step)) != ORC__OK) {
+      orc__decode_error(status);
+      goto done;
+    }
   }
-  if (reader->post_script->writerversion == 4) {
-    value = PyString_FromFormat("%i.%i with HIVE-13083", reader->post_script->version[0], reader->post_script->version[1]);
+
+  if ((statistics = PyMem_Malloc(sizeof(Orc__Proto__ColumnStatistics *)*(stripe_count+1))) == NULL) {
+    PyErr_NoMemory();
+    goto done;
   }
-  if (reader->post_script->writerversion == 5) {
-    value = PyString_FromFormat("%i.%i with ORC-101", reader->post_script->version[0], reader->post_script->version[1]);
+  if ((ret = PyList_New(n_indexes)) == NULL) {
+    goto done;
   }
-  if (reader->post_script->writerversion == 6) {
-    value = PyString_FromFormat("%i.%i with ORC-135", reader->post_script->version[0], reader->post_script->version[1]);
+  for (n=0; n < n_indexes; ++n) {
+    if (orc__columnar__gather(self->reader, indexes[n], start, step, stripe_count, statistics) != ORC__OK) {
+      PyErr_Format(PyExc_ValueError, "Column %llu has no statistics, it may not be selected.",
+                   (unsigned long long) indexes[n]);
+      value = NULL;
+    }
+    else {
+      value = orc__build_columnar_statistics(indexes[n], statistics, stripe_count);
+    }
+    if (value == NULL) {
+      Py_CLEAR(ret);
+      break;
+    }
+    PyList_SET_ITEM(ret, n, value);
   }
-  Py_MEMCHECK(value);
-  PyDict_SetItemString(ret, "version", value); 
-  Py_DECREF(value);
 
-  value = Py_BuildValue("K", reader->post_script->compressionblocksize);
-  Py_MEMCHECK(value);
-  PyDict_SetItemString(ret, "compression_size", value); 
-  Py_DECREF(value);
+done:
+  PyMem_Free(statistics);
+  PyMem_Free(indexes);
+  return ret;
+}
 
- 
-  /* Build schema */
-  if (enable_schema) {
-    PyObject *output = PyString_FromString("");
-    Py_MEMCHECK(output);
+/* Stripe table or file statistics of an OrcMetadata, exported through the Arrow PyCapsule interface. Every
+ * export builds a new record batch, so it can be imported any number of times. */
+typedef struct orc__arrow_batch_t {
+  PyObject_HEAD
+  orc__metadata_t *metadata;
+
+  /* A single row of file statistics instead of a row per stripe */
+  int file_stats;
+
+  /* Columns whose statistics are exported, allocated with PyMem_Malloc */
+  uint64_t *columns;
+  Py_ssize_t n_columns;
 
-    orc__build_schema(&output, reader->footer->types, reader->footer->types[0]);
+  /* Stripes start+n*step for n below count */
+  Py_ssize_t start;
+  Py_ssize_t step;
+  Py_ssize_t count;
+} orc__arrow_batch_t;
 
-    PyDict_SetItemString(ret, "schema", output);
-    Py_DECREF(output);
+static PyTypeObject orc__arrow_batch_type;
+
+static void orc__arrow_batch__dealloc(orc__arrow_batch_t *self) {
+  PyMem_Free(self->columns);
+  Py_DECREF(self->metadata);
+  PyObject_Del(self);
+}
+
+static void orc__arrow_batch__free_schema(PyObject *capsule) {
+  struct ArrowSchema *schema = PyCapsule_GetPointer(capsule, "arrow_schema");
+  if (schema->release != NULL) {
+    schema->release(schema);
   }
+  free(schema);
+}
 
-  PyObject *ptr, *stripe_stats, *col_stats, *stripe_stat_section;
+static void orc__arrow_batch__free_array(PyObject *capsule) {
+  struct ArrowArray *array = PyCapsule_GetPointer(capsule, "arrow_array");
+  if (array->release != NULL) {
+    array->release(array);
+  }
+  free(array);
+}
 
+/* Build the record batch into new capsules owning its schema and array, the metadata must still be open */
+static int orc__arrow_batch__build(orc__arrow_batch_t *self, PyObject **schema_capsule, PyObject **array_capsule) {
+  struct ArrowSchema *schema;
+  struct ArrowArray *array;
+  if (orc__metadata__check_open(self->metadata) != 0) {
+    return -1;
+  }
+  if ((schema = malloc(sizeof(struct ArrowSchema))) == NULL) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  if ((array = malloc(sizeof(struct ArrowArray))) == NULL) {
+    free(schema);
+    PyErr_NoMemory();
+    return -1;
+  }
 
-  /* Build Stripe Statistics */
-  if (enable_stripe_stats) {
-    stripe_stats = PyList_New(reader->metadata->n_stripestats);
-    Py_MEMCHECK(stripe_stats);
-    for (i=0; i < reader->metadata->n_stripestats; ++i) {
-
-      stripe_stat_section = PyDict_New();
-      Py_MEMCHECK(stripe_stat_section);
-
-      col_stats = PyList_New(reader->metadata->stripestats[i]->n_colstats);
-      Py_MEMCHECK(col_stats);
-
-      for (j=0; j < reader->metadata->stripestats[i]->n_colstats; ++j) {
-        ptr = PyDict_New();
-        Py_MEMCHECK(ptr);
-
-        value = Py_BuildValue("i", j);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(ptr, "column", value);
-        Py_DECREF(value);
-
-        value = PyBool_FromLong(reader->metadata->stripestats[i]->colstats[j]->hasnull);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(ptr, "has null", value);
-        Py_DECREF(value);
-
-        value = Py_BuildValue("i", reader->metadata->stripestats[i]->colstats[j]->numberofvalues);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(ptr, "count", value);
-        Py_DECREF(value);
- 
-        if (reader->metadata->stripestats[i]->colstats[j]->intstatistics != NULL) {
-          if (reader->metadata->stripestats[i]->colstats[j]->intstatistics->has_minimum) { 
-            value = Py_BuildValue("i", reader->metadata->stripestats[i]->colstats[j]->intstatistics->minimum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "min", value);
-            Py_DECREF(value);
-          }
-          if (reader->metadata->stripestats[i]->colstats[j]->intstatistics->has_maximum) {
-            value = Py_BuildValue("i", reader->metadata->stripestats[i]->colstats[j]->intstatistics->maximum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "max", value);
-            Py_DECREF(value);
-          }
-          if (reader->metadata->stripestats[i]->colstats[j]->intstatistics->has_sum) {
-            value = Py_BuildValue("i", reader->metadata->stripestats[i]->colstats[j]->intstatistics->sum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "sum", value);
-            Py_DECREF(value);
-          }
-        }
-    
-        if (reader->metadata->stripestats[i]->colstats[j]->doublestatistics != NULL) {
-          if (reader->metadata->stripestats[i]->colstats[j]->doublestatistics->has_minimum) {
-            value = Py_BuildValue("d", reader->metadata->stripestats[i]->colstats[j]->doublestatistics->minimum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "min", value);
-            Py_DECREF(value);
-          }
-          if (reader->metadata->stripestats[i]->colstats[j]->doublestatistics->has_maximum) {
-            value = Py_BuildValue("d", reader->metadata->stripestats[i]->colstats[j]->doublestatistics->maximum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "max", value);
-            Py_DECREF(value);
-          }
-          if (reader->metadata->stripestats[i]->colstats[j]->doublestatistics->has_sum) {
-            value = Py_BuildValue("d", reader->metadata->stripestats[i]->colstats[j]->doublestatistics->sum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "sum", value);
-            Py_DECREF(value);
-          }
-        }
-    
-        if (reader->metadata->stripestats[i]->colstats[j]->stringstatistics != NULL) {
-          value = Py_BuildValue("s", reader->metadata->stripestats[i]->colstats[j]->stringstatistics->minimum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "min", value);
-          Py_DECREF(value);
-    
-          value = Py_BuildValue("s", reader->metadata->stripestats[i]->colstats[j]->stringstatistics->maximum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "max", value);
-          Py_DECREF(value);
-    
-          if (reader->metadata->stripestats[i]->colstats[j]->stringstatistics->has_sum) {
-            value = Py_BuildValue("i", reader->metadata->stripestats[i]->colstats[j]->stringstatistics->sum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "sum", value);
-            Py_DECREF(value);
-          }
-        }
-    
-        if (reader->metadata->stripestats[i]->colstats[j]->decimalstatistics != NULL) { 
-          value = Py_BuildValue("s", reader->metadata->stripestats[i]->colstats[j]->decimalstatistics->minimum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "min", value);
-          Py_DECREF(value);
-    
-          value = Py_BuildValue("s", reader->metadata->stripestats[i]->colstats[j]->decimalstatistics->maximum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "max", value);
-          Py_DECREF(value);
-    
-          value = Py_BuildValue("s", reader->metadata->stripestats[i]->colstats[j]->decimalstatistics->sum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "sum", value);
-          Py_DECREF(value);
-        }
-    
-        if (reader->metadata->stripestats[i]->colstats[j]->datestatistics != NULL) {
-          if (reader->metadata->stripestats[i]->colstats[j]->datestatistics->has_minimum) {
-            value = Py_BuildValue("i", reader->metadata->stripestats[i]->colstats[j]->datestatistics->minimum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "min", value);
-            Py_DECREF(value);
-          }
-          if (reader->metadata->stripestats[i]->colstats[j]->datestatistics->has_maximum) {
-            value = Py_BuildValue("i", reader->metadata->stripestats[i]->colstats[j]->datestatistics->maximum);
-            Py_MEMCHECK(value);
-            PyDict_SetItemString(ptr, "max", value);
-            Py_DECREF(value);
-          }
-        }
-        PyList_SetItem(col_stats, j, ptr);
-      }
+  int status;
+  orc__reader_t *reader = self->metadata->reader;
+  if (self->file_stats) {
+    status = orc__arrow__export_file_statistics(reader, self->columns, self->n_columns, schema, array);
+  }
+  else {
+    status = orc__arrow__export_stripes(reader, self->columns, self->n_columns, self->start, self->step,
+                                        self->count, schema, array);
+  }
+  if (status != ORC__OK) {
+    free(schema);
+    free(array);
+    orc__decode_error(status);
+    return -1;
+  }
 
-      value = Py_BuildValue("i", i);
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(stripe_stat_section, "stripe", value);
-      Py_DECREF(value);
+  if ((*schema_capsule = PyCapsule_New(schema, "arrow_schema", orc__arrow_batch__free_schema)) == NULL) {
+    schema->release(schema);
+    free(schema);
+    array->release(array);
+    free(array);
+    return -1;
+  }
+  if ((*array_capsule = PyCapsule_New(array, "arrow_array", orc__arrow_batch__free_array)) == NULL) {
+    array->release(array);
+    free(array);
+    Py_CLEAR(*schema_capsule);
+    return -1;
+  }
+  return 0;
+}
 
-      PyDict_SetItemString(stripe_stat_section, "statistics", col_stats);
-      Py_DECREF(col_stats);
+/* The requested schema is ignored, consumers cast the batch themselves */
+static PyObject *orc__arrow_batch__c_array(orc__arrow_batch_t *self, PyObject *args, PyObject *kwargs) {
+  PyObject *requested_schema = Py_None;
+  static char *kwlist[] = {"requested_schema", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &requested_schema)) {
+    return NULL;
+  }
 
-      PyList_SetItem(stripe_stats, i, stripe_stat_section);
-    }
+  PyObject *schema, *array;
+  if (orc__arrow_batch__build(self, &schema, &array) != 0) {
+    return NULL;
+  }
+  return Py_BuildValue("(NN)", schema, array);
+}
 
-    PyDict_SetItemString(ret, "Stripe Statistics", stripe_stats);
-    Py_DECREF(stripe_stats);
+static PyObject *orc__arrow_batch__c_schema(orc__arrow_batch_t *self, PyObject *unused) {
+  PyObject *schema, *array;
+  if (orc__arrow_batch__build(self, &schema, &array) != 0) {
+    return NULL;
   }
+  Py_DECREF(array);
+  return schema;
+}
 
-  /* Build File Statistics */
-  if (enable_file_stats) {
-    col_stats = PyList_New(reader->footer->n_statistics);
-    Py_MEMCHECK(col_stats);
-    for (i=0; i < reader->footer->n_statistics; ++i) {
-      ptr = PyDict_New();
-      Py_MEMCHECK(ptr);
-
-      value = Py_BuildValue("i", i);
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(ptr, "column", value);
-      Py_DECREF(value);
-
-      value = PyBool_FromLong(reader->footer->statistics[i]->hasnull);
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(ptr, "has null", value);
-      Py_DECREF(value);
-
-      value = Py_BuildValue("i", reader->footer->statistics[i]->numberofvalues);
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(ptr, "count", value);
-      Py_DECREF(value);
-
-      if (reader->footer->statistics[i]->intstatistics != NULL) {
-        if (reader->footer->statistics[i]->intstatistics->has_minimum) { 
-          value = Py_BuildValue("i", reader->footer->statistics[i]->intstatistics->minimum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "min", value);
-          Py_DECREF(value);
-        }
-        if (reader->footer->statistics[i]->intstatistics->has_maximum) {
-          value = Py_BuildValue("i", reader->footer->statistics[i]->intstatistics->maximum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "max", value);
-          Py_DECREF(value);
-        }
-        if (reader->footer->statistics[i]->intstatistics->has_sum) {
-          value = Py_BuildValue("i", reader->footer->statistics[i]->intstatistics->sum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "sum", value);
-          Py_DECREF(value);
-        }
-      }
+static PyObject *orc__arrow_batch__get_num_rows(orc__arrow_batch_t *self, void *closure) {
+  return Py_BuildValue("n", self->file_stats ? 1 : self->count);
+}
 
-      if (reader->footer->statistics[i]->doublestatistics != NULL) {
-        if (reader->footer->statistics[i]->doublestatistics->has_minimum) {
-          value = Py_BuildValue("d", reader->footer->statistics[i]->doublestatistics->minimum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "min", value);
-          Py_DECREF(value);
-        }
-        if (reader->footer->statistics[i]->doublestatistics->has_maximum) {
-          value = Py_BuildValue("d", reader->footer->statistics[i]->doublestatistics->maximum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "max", value);
-          Py_DECREF(value);
-        }
-        if (reader->footer->statistics[i]->doublestatistics->has_sum) {
-          value = Py_BuildValue("d", reader->footer->statistics[i]->doublestatistics->sum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "sum", value);
-          Py_DECREF(value);
-        }
-      }
+static PyGetSetDef orc__arrow_batch_getset[] = {
+  {"num_rows", (getter) orc__arrow_batch__get_num_rows, NULL, "Number of rows of the batch.", NULL},
+  {NULL, NULL, NULL, NULL, NULL}
+};
 
-      if (reader->footer->statistics[i]->stringstatistics != NULL) {
-        value = Py_BuildValue("s", reader->footer->statistics[i]->stringstatistics->minimum);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(ptr, "min", value);
-        Py_DECREF(value);
-
-        value = Py_BuildValue("s", reader->footer->statistics[i]->stringstatistics->maximum);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(ptr, "max", value);
-        Py_DECREF(value);
-
-        if (reader->footer->statistics[i]->stringstatistics->has_sum) {
-          value = Py_BuildValue("i", reader->footer->statistics[i]->stringstatistics->sum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "sum", value);
-          Py_DECREF(value);
-        }
-      }
+static PyMethodDef orc__arrow_batch_methods[] = {
+  {"__arrow_c_array__", (PyCFunction) orc__arrow_batch__c_array, METH_VARARGS|METH_KEYWORDS,
+   "Export the batch as a pair of arrow_schema and arrow_array capsules."},
+  {"__arrow_c_schema__", (PyCFunction) orc__arrow_batch__c_schema, METH_NOARGS,
+   "Export the schema of the batch as an arrow_schema capsule."},
+  {NULL, NULL, 0, NULL}
+};
 
-      if (reader->footer->statistics[i]->decimalstatistics != NULL) { 
-        value = Py_BuildValue("s", reader->footer->statistics[i]->decimalstatistics->minimum);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(ptr, "min", value);
-        Py_DECREF(value);
-
-        value = Py_BuildValue("s", reader->footer->statistics[i]->decimalstatistics->maximum);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(ptr, "max", value);
-        Py_DECREF(value);
-
-        value = Py_BuildValue("s", reader->footer->statistics[i]->decimalstatistics->sum);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(ptr, "sum", value);
-        Py_DECREF(value);
-      }
+static PyTypeObject orc__arrow_batch_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "_orc_metadata.ArrowBatch",
+  .tp_basicsize = sizeof(orc__arrow_batch_t),
+  .tp_dealloc = (destructor) orc__arrow_batch__dealloc,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_doc = "Record batch of ORC metadata exported through the Arrow C Data Interface.",
+  .tp_methods = orc__arrow_batch_methods,
+  .tp_getset = orc__arrow_batch_getset,
+};
 
-      if (reader->footer->statistics[i]->datestatistics != NULL) {
-        if (reader->footer->statistics[i]->datestatistics->has_minimum) {
-          value = Py_BuildValue("i", reader->footer->statistics[i]->datestatistics->minimum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "min", value);
-          Py_DECREF(value);
-        }
-        if (reader->footer->statistics[i]->datestatistics->has_maximum) {
-          value = Py_BuildValue("i", reader->footer->statistics[i]->datestatistics->maximum);
-          Py_MEMCHECK(value);
-          PyDict_SetItemString(ptr, "max", value);
-          Py_DECREF(value);
-        }
+/* Columns of an Arrow export, every selected column with statistics when columns is None */
+static int orc__arrow_batch__columns(orc__arrow_batch_t *self, PyObject *columns, size_t n_statistics) {
+  orc__reader_t *reader = self->metadata->reader;
+  Py_ssize_t n;
+  if (columns != Py_None) {
+    if (orc__column_indexes(NULL, columns, &self->columns, &self->n_columns) != 0) {
+      return -1;
+    }
+    for (n=0; n < self->n_columns; ++n) {
+      if (self->columns[n] >= n_statistics || !orc__reader__column_selected(reader, self->columns[n])) {
+        PyErr_Format(PyExc_ValueError, "Column %llu has no statistics, it may not be selected.",
+                     (unsigned long long) self->columns[n]);
+        return -1;
       }
-      PyList_SetItem(col_stats, i, ptr);
     }
+    return 0;
+  }
 
-    PyDict_SetItemString(ret, "File Statistics", col_stats);
-    Py_DECREF(col_stats);
+  if ((self->columns = PyMem_Malloc(sizeof(uint64_t)*(n_statistics+1))) == NULL) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  self->n_columns = 0;
+  for (n=0; (size_t) n < n_statistics; ++n) {
+    if (orc__reader__column_selected(reader, n)) {
+      self->columns[self->n_columns++] = n;
+    }
   }
+  return 0;
+}
 
-  /* Build Stripe Footers */
-  if (enable_stripes) {
-    PyObject *stripes, *stripe, *stream, *encoding_col;
-    PyObject *stream_list, *encoding_list;
+static PyObject *orc__metadata__stripe_table(orc__metadata_t *self, PyObject *args, PyObject *kwargs) {
+  PyObject *columns = Py_None;
+  PyObject *stripe_range = Py_None;
+  static char *kwlist[] = {"columns", "stripe_range", NULL};
 
-    stripes = PyList_New(reader->footer->n_stripes);
-    Py_MEMCHECK(stripes);
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OO", kwlist, &columns, &stripe_range)) {
+    return NULL;
+  }
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
+  if (stripe_range != Py_None && !PySlice_Check(stripe_range)) {
+    PyErr_SetString(PyExc_TypeError, "stripe_range must be a slice.");
+    return NULL;
+  }
 
-    int64_t stream_offset;
-    for (i=0; i < reader->footer->n_stripes; ++i) {
-      stripe = PyDict_New();
-      Py_MEMCHECK(stripe);
-
-      value = Py_BuildValue("i", i);
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(stripe, "stripe", value);
-      Py_DECREF(value);
-
-      value = Py_BuildValue("i", reader->footer->stripes[i]->offset);  
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(stripe, "offset", value);
-      Py_DECREF(value);
-
-      value = Py_BuildValue("i", reader->footer->stripes[i]->datalength);  
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(stripe, "data", value);
-      Py_DECREF(value);
-
-      value = Py_BuildValue("i", reader->footer->stripes[i]->numberofrows);  
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(stripe, "rows", value);
-      Py_DECREF(value);
-
-      value = Py_BuildValue("i", reader->footer->stripes[i]->footerlength);
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(stripe, "tail", value);
-      Py_DECREF(value);
-
-      value = Py_BuildValue("i", reader->footer->stripes[i]->indexlength);
-      Py_MEMCHECK(value);
-      PyDict_SetItemString(stripe, "index", value);
-      Py_DECREF(value);
-
-      stream_offset = reader->footer->stripes[i]->offset;
-      stream_list = PyList_New(reader->stripe_footers[i]->n_streams);
-      Py_MEMCHECK(stream_list);
-      for (j=0; j < reader->stripe_footers[i]->n_streams; ++j) { 
-        stream = PyDict_New();
-        Py_MEMCHECK(stream);
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__PRESENT) {
-          value = PyString_FromString("PRESENT");
-        }
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__DATA) {
-          value = PyString_FromString("DATA");
-        }
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__LENGTH) {
-          value = PyString_FromString("LENGTH");
-        }
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__DICTIONARY_DATA) {
-          value = PyString_FromString("DICTIONARY_DATA");
-        }
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__DICTIONARY_COUNT) {
-          value = PyString_FromString("DICTIONARY_COUNT");
-        }
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__SECONDARY) {
-          value = PyString_FromString("SECONDARY");
-        }
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__ROW_INDEX) {
-          value = PyString_FromString("ROW_INDEX");
-        }
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__BLOOM_FILTER) {
-          value = PyString_FromString("BLOOM_FILTER");
-        }
-
-        if (reader->stripe_footers[i]->streams[j]->kind == ORC__STREAM_KIND__BLOOM_FILTER_UTF8) {
-          value = PyString_FromString("BLOOM_FILTER_UTF8");
-        }
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(stream, "section", value);
-        Py_DECREF(value);
-
-        value = Py_BuildValue("i", reader->stripe_footers[i]->streams[j]->column);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(stream, "column", value);
-        Py_DECREF(value);
-
-        value = Py_BuildValue("i", stream_offset);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(stream, "start", value);
-        Py_DECREF(value);
-
-        value = Py_BuildValue("i", reader->stripe_footers[i]->streams[j]->length);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(stream, "length", value);
-        Py_DECREF(value);
-
-        PyList_SetItem(stream_list, j, stream);
-        
-        stream_offset += reader->stripe_footers[i]->streams[j]->length;
-      }
+  int status;
+  orc__reader_t *reader = self->reader;
+  if ((status = orc__reader__decode_footer_field(reader, ORC__FOOTER_FIELD__STRIPES)) != ORC__OK) {
+    return orc__decode_error(status);
+  }
+
+  orc__arrow_batch_t *batch;
+  if ((batch = PyObject_New(orc__arrow_batch_t, &orc__arrow_batch_type)) == NULL) {
+    return NULL;
+  }
+  Py_INCREF(self);
+  batch->metadata = self;
+  batch->columns = NULL;
+  batch->file_stats = 0;
+  batch->start = 0;
+  batch->step = 1;
+  batch->count = reader->footer->n_stripes;
+
+  Py_ssize_t n, stop;
+  if ((stripe_range != Py_None &&
+       PySlice_GetIndicesEx(ORC__SLICE(stripe_range), batch->count, &batch->start, &stop, &batch->step,
+                            &batch->count) != 0) ||
+      orc__arrow_batch__columns(batch, columns, reader->footer_fields[ORC__FOOTER_FIELD__STATISTICS].count) != 0) {
+    Py_DECREF(batch);
+    return NULL;
+  }
 
-      encoding_list = PyList_New(reader->stripe_footers[i]->n_columns); 
-      Py_MEMCHECK(encoding_list);
-      for (j=0; j < reader->stripe_footers[i]->n_columns; ++j) {
-        encoding_col = PyDict_New();
-        Py_MEMCHECK(encoding_col);
-
-        if (reader->stripe_footers[i]->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DIRECT) {
-          value = PyString_FromString("DIRECT");
-        }
-        if (reader->stripe_footers[i]->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DICTIONARY) {
-          value = PyString_FromFormat("DICTIONARY[%i]", reader->stripe_footers[i]->columns[j]->dictionarysize);
-        }
-        if (reader->stripe_footers[i]->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DIRECT_V2) {
-          value = PyString_FromString("DIRECT_V2");
-        }
-        if (reader->stripe_footers[i]->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DICTIONARY_V2) {
-          value = PyString_FromFormat("DICTIONARY_V2[%i]", reader->stripe_footers[i]->columns[j]->dictionarysize);
-        }
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(encoding_col, "encoding", value);
-        Py_DECREF(value);
-
-        value = Py_BuildValue("i", j);
-        Py_MEMCHECK(value);
-        PyDict_SetItemString(encoding_col, "column", value);
-        Py_DECREF(value);
-
-        PyList_SetItem(encoding_list, j, encoding_col);
+  /* Statistics of the exported stripes are decoded once, the metadata keeps them */
+  if (batch->n_columns > 0) {
+    status = orc__reader__decode_metadata(reader);
+    for (n=0; n < batch->count && status == ORC__OK; ++n) {
+      if ((size_t) (batch->start+n*batch->step) < reader->metadata->n_stripestats) {
+        status = orc__reader__decode_stripe_statistics(reader, batch->start+n*batch->step);
       }
+    }
+    if (status != ORC__OK) {
+      Py_DECREF(batch);
+      return orc__decode_error(status);
+    }
+  }
+  return (PyObject *) batch;
+}
 
-      PyDict_SetItemString(stripe, "Streams", stream_list);
-      Py_DECREF(stream_list);
+static PyObject *orc__metadata__file_stats_table(orc__metadata_t *self, PyObject *args, PyObject *kwargs) {
+  PyObject *columns = Py_None;
+  static char *kwlist[] = {"columns", NULL};
 
-      PyDict_SetItemString(stripe, "Encodings", encoding_list);
-      Py_DECREF(encoding_list);
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &columns)) {
+    return NULL;
+  }
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
+  }
 
-      PyList_SetItem(stripes, i, stripe);
-    }
+  int status;
+  orc__reader_t *reader = self->reader;
+  if ((status = orc__reader__decode_footer_field(reader, ORC__FOOTER_FIELD__STATISTICS)) != ORC__OK) {
+    return orc__decode_error(status);
+  }
 
-    PyDict_SetItemString(ret, "Stripes", stripes);
-    Py_DECREF(stripes);
+  orc__arrow_batch_t *batch;
+  if ((batch = PyObject_New(orc__arrow_batch_t, &orc__arrow_batch_type)) == NULL) {
+    return NULL;
+  }
+  Py_INCREF(self);
+  batch->metadata = self;
+  batch->columns = NULL;
+  batch->file_stats = 1;
+  batch->start = 0;
+  batch->step = 1;
+  batch->count = 1;
+  if (orc__arrow_batch__columns(batch, columns, reader->footer->n_statistics) != 0) {
+    Py_DECREF(batch);
+    return NULL;
   }
+  return (PyObject *) batch;
+}
 
-  orc__reader__free(reader);
+/* Every stripe, or the statistics of every stripe, as one list */
+static PyObject *orc__metadata__all(orc__metadata_t *self, PyObject *(*get)(orc__metadata_t *, PyObject *),
+                                    Py_ssize_t n) {
+  Py_ssize_t i;
+  PyObject *args, *value, *ret;
+  if ((ret = PyList_New(n)) == NULL) {
+    return NULL;
+  }
+  for (i=0; i < n; ++i) {
+    if ((args = Py_BuildValue("(n)", i)) == NULL) {
+      Py_DECREF(ret);
+      return NULL;
+    }
+    value = get(self, args);
+    Py_DECREF(args);
+    if (value == NULL) {
+      Py_DECREF(ret);
+      return NULL;
+    }
+    PyList_SET_ITEM(ret, i, value);
+  }
   return ret;
 }
 
-void orc__build_schema(PyObject **output, Orc__Proto__Type **types, Orc__Proto__Type *type) {
-  PyObject *val;
-
-  if (type->kind == ORC__TYPE_KIND__BOOLEAN) {
-    val = PyString_FromString("boolean");
-  }
-  if (type->kind == ORC__TYPE_KIND__BYTE) {
-    val = PyString_FromString("byte");
+static PyObject *orc__metadata__get_stripes(orc__metadata_t *self, void *closure) {
+  int status;
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
   }
-  if (type->kind == ORC__TYPE_KIND__SHORT) {
-    val = PyString_FromString("tinyint");
+  if ((status = orc__reader__decode_footer_field(self->reader, ORC__FOOTER_FIELD__STRIPES)) != ORC__OK) {
+    return orc__decode_error(status);
   }
-  if (type->kind == ORC__TYPE_KIND__INT) {
-    val = PyString_FromString("int");
+  return orc__metadata__all(self, orc__metadata__stripe, self->reader->footer->n_stripes);
+}
+
+static PyObject *orc__metadata__get_all_stripe_stats(orc__metadata_t *self, void *closure) {
+  int status;
+  if (orc__metadata__check_open(self) != 0) {
+    return NULL;
   }
-  if (type->kind == ORC__TYPE_KIND__LONG) {
-    val = PyString_FromString("bigint");
+  if ((status = orc__reader__decode_metadata(self->reader)) != ORC__OK) {
+    return orc__decode_error(status);
   }
-  if (type->kind == ORC__TYPE_KIND__FLOAT) {
-    val = PyString_FromString("float");
+  return orc__metadata__all(self, orc__metadata__stripe_stats, self->reader->metadata->n_stripestats);
+}
+
+/* The keys of the read_metadata dict, so that code written against it keeps working */
+static PyObject *orc__metadata__subscript(orc__metadata_t *self, PyObject *key) {
+  const char *name = PyString_Check(key) ? PyString_AsString(key) : NULL;
+  if (name == NULL) {
+    PyErr_Clear();
   }
-  if (type->kind == ORC__TYPE_KIND__DOUBLE) {
-    val = PyString_FromString("double");
+  else if (strcmp(name, "rows") == 0) {
+    return orc__metadata__get_rows(self, NULL);
   }
-  if (type->kind == ORC__TYPE_KIND__STRING) {
-    val = PyString_FromString("string");
+  else if (strcmp(name, "compression") == 0) {
+    return orc__metadata__get_compression(self, NULL);
   }
-  if (type->kind == ORC__TYPE_KIND__BINARY) {
-    val = PyString_FromString("binary");
+  else if (strcmp(name, "version") == 0) {
+    return orc__metadata__get_version(self, NULL);
   }
-  if (type->kind == ORC__TYPE_KIND__TIMESTAMP) {
-    val = PyString_FromString("timestamp");
+  else if (strcmp(name, "compression_size") == 0) {
+    return orc__metadata__get_compression_size(self, NULL);
   }
-  if (type->kind == ORC__TYPE_KIND__LIST) {
-    val = PyString_FromString("array<");
+  else if (strcmp(name, "schema") == 0) {
+    return orc__metadata__get_schema(self, NULL);
   }
-  if (type->kind == ORC__TYPE_KIND__MAP) {
-    val = PyString_FromString("map<");
+  else if (strcmp(name, "File Statistics") == 0) {
+    return orc__metadata__get_file_stats(self, NULL);
   }
-  if (type->kind == ORC__TYPE_KIND__STRUCT) {
-    val = PyString_FromString("struct<");
+  else if (strcmp(name, "Stripe Statistics") == 0) {
+    return orc__metadata__get_all_stripe_stats(self, NULL);
   }
-  if (type->kind == ORC__TYPE_KIND__UNION) {
-    val = PyString_FromString("union<");
+  else if (strcmp(name, "Stripes") == 0) {
+    return orc__metadata__get_stripes(self, NULL);
   }
-  if (type->kind == ORC__TYPE_KIND__DECIMAL) {
-    val = PyString_FromString("decimal");
+  PyErr_SetObject(PyExc_KeyError, key);
+  return NULL;
+}
+
+static PyGetSetDef orc__metadata_getset[] = {
+  {"rows", (getter) orc__metadata__get_rows, NULL, "Number of rows.", NULL},
+  {"compression", (getter) orc__metadata__get_compression, NULL, "Compression kind.", NULL},
+  {"version", (getter) orc__metadata__get_version, NULL, "Writer version.", NULL},
+  {"compression_size", (getter) orc__metadata__get_compression_size, NULL, "Compression block size.", NULL},
+  {"n_stripes", (getter) orc__metadata__get_n_stripes, NULL, "Number of stripes.", NULL},
+  {"schema", (getter) orc__metadata__get_schema, NULL, "Schema as a type string.", NULL},
+  {"file_stats", (getter) orc__metadata__get_file_stats, NULL, "Statistics of the selected columns.", NULL},
+  {"stripes", (getter) orc__metadata__get_stripes, NULL, "Every stripe along with its footer.", NULL},
+  {"closed", (getter) orc__metadata__get_closed, NULL, "Whether the file or buffer was released.", NULL},
+  {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMethodDef orc__metadata_methods[] = {
+  {"stripe_stats", (PyCFunction) orc__metadata__stripe_stats, METH_VARARGS, "Statistics of stripe i."},
+  {"stripe", (PyCFunction) orc__metadata__stripe, METH_VARARGS, "Stripe i along with its footer."},
+  {"column_stats", (PyCFunction) orc__metadata__column_stats, METH_VARARGS|METH_KEYWORDS,
+   "Statistics of each of the columns over the stripes as arrays, one entry per stripe."},
+  {"stripe_table", (PyCFunction) orc__metadata__stripe_table, METH_VARARGS|METH_KEYWORDS,
+   "Stripes along with the statistics of the columns as an Arrow record batch."},
+  {"file_stats_table", (PyCFunction) orc__metadata__file_stats_table, METH_VARARGS|METH_KEYWORDS,
+   "File statistics of the columns as an Arrow record batch of one row."},
+  {"close", (PyCFunction) orc__metadata__close, METH_NOARGS, "Release the file or buffer, any further access raises ValueError."},
+  {"__enter__", (PyCFunction) orc__metadata__enter, METH_NOARGS, "Return the metadata itself."},
+  {"__exit__", (PyCFunction) orc__metadata__exit, METH_VARARGS, "Close the metadata."},
+  {NULL, NULL, 0, NULL}
+};
+
+static PyMappingMethods orc__metadata_mapping = {
+  NULL, (binaryfunc) orc__metadata__subscript, NULL
+};
+
+static PyTypeObject orc__metadata_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "_orc_metadata.OrcMetadata",
+  .tp_basicsize = sizeof(orc__metadata_t),
+  .tp_dealloc = (destructor) orc__metadata__dealloc,
+  .tp_as_mapping = &orc__metadata_mapping,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_doc = "Metadata of an ORC file, decoded and built on first access.",
+  .tp_methods = orc__metadata_methods,
+  .tp_getset = orc__metadata_getset,
+};
+
+static PyObject *open_metadata(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+  const char *input_path;
+  int use_mmap = 0;
+  int decompress_threads = 1;
+  PyObject *columns = Py_None;
+  int records = 0;
+  static char *kwlist[] = {"input_path", "use_mmap", "decompress_threads", "columns", "records", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|iiOi", kwlist, &input_path, &use_mmap, &decompress_threads,
+                                   &columns, &records)) {
+    PyErr_BadArgument();
+    return NULL;
   }
-  if (type->kind == ORC__TYPE_KIND__DATE) {
-    val = PyString_FromString("date");
+
+  /* The metadata section is only read once stripe statistics are asked for */
+  orc__reader_t *reader;
+  Py_BEGIN_ALLOW_THREADS
+  if (use_mmap) {
+    reader = orc__reader__init_mmap(input_path, 0, 0);
   }
-  if (type->kind == ORC__TYPE_KIND__VARCHAR) {
-    val = PyString_FromString("varchar");
+  else {
+    reader = orc__reader__init(input_path, 0, 0);
   }
-  if (type->kind == ORC__TYPE_KIND__CHAR) {
-    val = PyString_FromString("char");
+  Py_END_ALLOW_THREADS
+  if (reader == NULL) {
+    PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *) input_path);
+    return NULL;
   }
+  return orc__metadata__new(reader, NULL, decompress_threads, columns, records);
+}
 
-  PyString_CONCAT(output, val);
-  
-  int i;
-  for (i=0;i<type->n_subtypes; ++i) {
-    if (type->n_fieldnames) {
-      PyString_CONCAT(output, PyString_FromString(type->fieldnames[i]));
-      PyString_CONCAT(output, PyString_FromString(":"));
-    }
+static PyObject *open_metadata_buffer(PyObject *self, PyObject *args, PyObject *kwargs) {
 
-    orc__build_schema(output, types, types[type->subtypes[i]]);
+  Py_buffer input;
+  int decompress_threads = 1;
+  PyObject *columns = Py_None;
+  int records = 0;
+  static char *kwlist[] = {"input", "decompress_threads", "columns", "records", NULL};
 
-    if (i<type->n_subtypes-1) { 
-      PyString_CONCAT(output, PyString_FromString(","));
-    }
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, ORC__BUFFER "|iOi", kwlist, &input, &decompress_threads, &columns,
+                                   &records)) {
+    PyErr_BadArgument();
+    return NULL;
   }
-  if (type->kind == 10 || type->kind == 11 || type->kind == 12 || type->kind == 13) { 
-    PyString_CONCAT(output, PyString_FromString(">"));
+
+  /* The buffer is held by the result for as long as the reader borrows it */
+  orc__reader_t *reader;
+  if ((reader = orc__reader__init_from_buffer((uint8_t *) input.buf, input.len, 0, 0)) == NULL) {
+    PyBuffer_Release(&input);
+    return PyErr_NoMemory();
   }
+  return orc__metadata__new(reader, &input, decompress_threads, columns, records);
 }
 
 static char module_docstring[] = "This module provides an interface for reading ORC files in C.";
 static char func_docstring[] = "Read ORC file metadata.";
+static char buffer_func_docstring[] = "Read ORC file metadata from an object supporting the buffer protocol.";
+static char many_func_docstring[] = "Read the metadata of many ORC files on a pool of native threads.";
+static char tail_length_docstring[] = "Number of trailing bytes of an ORC file needed to read its metadata.";
+static char buffer_generic_func_docstring[] = "Read all ORC file metadata from a buffer with the generic unpack.";
+static char open_func_docstring[] = "Open ORC file metadata, which is decoded as it is accessed.";
+static char open_buffer_func_docstring[] = "Open ORC file metadata from an object supporting the buffer protocol.";
+static char json_func_docstring[] = "Read ORC file metadata as JSON.";
+static char buffer_json_func_docstring[] = "Read ORC file metadata as JSON from an object supporting the buffer protocol.";
 
 static PyMethodDef module_methods[] = {
       {"read_metadata", (PyCFunction) read_metadata, METH_VARARGS|METH_KEYWORDS, func_docstring},
+      {"read_metadata_buffer", (PyCFunction) read_metadata_buffer, METH_VARARGS|METH_KEYWORDS, buffer_func_docstring},
+      {"read_metadata_many", (PyCFunction) read_metadata_many, METH_VARARGS|METH_KEYWORDS, many_func_docstring},
+      {"open_metadata", (PyCFunction) open_metadata, METH_VARARGS|METH_KEYWORDS, open_func_docstring},
+      {"open_metadata_buffer", (PyCFunction) open_metadata_buffer, METH_VARARGS|METH_KEYWORDS,
+       open_buffer_func_docstring},
+      {"read_metadata_json", (PyCFunction) read_metadata_json, METH_VARARGS|METH_KEYWORDS, json_func_docstring},
+      {"read_metadata_buffer_json", (PyCFunction) read_metadata_buffer_json, METH_VARARGS|METH_KEYWORDS,
+       buffer_json_func_docstring},
+      {"tail_length", (PyCFunction) tail_length, METH_VARARGS|METH_KEYWORDS, tail_length_docstring},
+      {"_read_metadata_buffer_generic", (PyCFunction) read_metadata_buffer_generic, METH_VARARGS,
+       buffer_generic_func_docstring},
       {NULL, NULL, 0, NULL}
 };
 
+/* Create the objects of count names, which stay alive for the life of the process. NULL names are skipped. */
+static int orc__init_names(PyObject **objects, const char **names, size_t count) {
+  size_t i;
+  for (i=0; i < count; ++i) {
+    if (names[i] != NULL && (objects[i] = PyString_InternFromString(names[i])) == NULL) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static PyObject *orc__build_compressions(void) {
+  PyObject *compressions, *name;
+  Py_ssize_t i, n;
+  for (n=0; orc__compiled_compressions[n] != NULL; ++n);
+  if ((compressions = PyTuple_New(n)) == NULL) {
+    return NULL;
+  }
+  for (i=0; i < n; ++i) {
+    if ((name = PyString_InternFromString(orc__compiled_compressions[i])) == NULL) {
+      Py_DECREF(compressions);
+      return NULL;
+    }
+    PyTuple_SET_ITEM(compressions, i, name);
+  }
+  return compressions;
+}
+
+static int orc__init_versions(void) {
+  size_t i, j;
+  for (i=0; i < ORC__FILE_VERSIONS; ++i) {
+    for (j=0; j < ORC__WRITER_VERSIONS; ++j) {
+      orc__versions[i][j] = PyString_FromFormat("0.%i with %s", (int) (ORC__FILE_VERSION_MINOR+i),
+                                                orc__writer_version_names[j]);
+      if (orc__versions[i][j] == NULL) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+static int orc__init_module(PyObject *mod) {
+  PyObject *metadata_type = (PyObject *) &orc__metadata_type;
+  PyObject *array_type = (PyObject *) &orc__array_type;
+  PyObject *arrow_batch_type = (PyObject *) &orc__arrow_batch_type;
+  PyObject *column_stats_type = (PyObject *) &orc__column_stats_type;
+  PyObject *stream_info_type = (PyObject *) &orc__stream_info_type;
+  PyObject *encoding_info_type = (PyObject *) &orc__encoding_info_type;
+  if ((ORCReadException = PyErr_NewException("_orc_metadata.ORCReadException", NULL, NULL)) == NULL ||
+      (orc__schema_cache = PyDict_New()) == NULL ||
+      orc__init_names(orc__keys, orc__key_names, ORC__KEYS) != 0 ||
+      orc__init_names(orc__compressions, orc__compression_names, ORC__COMPRESSION_KINDS) != 0 ||
+      orc__init_names(orc__stream_kinds, orc__stream_kind_names, ORC__STREAM_KINDS) != 0 ||
+      orc__init_names(orc__encodings, orc__encoding_names, ORC__ENCODING_KINDS) != 0 ||
+      orc__init_names(orc__columnar_kinds, orc__columnar_kind_names, ORC__COLUMNAR_KINDS) != 0 ||
+      orc__init_versions() != 0) {
+    return -1;
+  }
+  orc__json__init_shapes();
+  Py_INCREF(ORCReadException);
+  if (PyModule_AddObject(mod, "ORCReadException", ORCReadException) != 0 ||
+      PyType_Ready(&orc__metadata_type) != 0 || PyType_Ready(&orc__array_type) != 0 ||
+      PyType_Ready(&orc__arrow_batch_type) != 0 ||
+      PyStructSequence_InitType2(&orc__column_stats_type, &orc__column_stats_desc) != 0 ||
+      PyStructSequence_InitType2(&orc__stream_info_type, &orc__stream_info_desc) != 0 ||
+      PyStructSequence_InitType2(&orc__encoding_info_type, &orc__encoding_info_desc) != 0) {
+    return -1;
+  }
+  Py_INCREF(array_type);
+  Py_INCREF(arrow_batch_type);
+  Py_INCREF(column_stats_type);
+  Py_INCREF(stream_info_type);
+  Py_INCREF(encoding_info_type);
+  if (PyModule_AddObject(mod, "StatisticsArray", array_type) != 0 ||
+      PyModule_AddObject(mod, "ArrowBatch", arrow_batch_type) != 0 ||
+      PyModule_AddObject(mod, "ColumnStats", column_stats_type) != 0 ||
+      PyModule_AddObject(mod, "StreamInfo", stream_info_type) != 0 ||
+      PyModule_AddObject(mod, "EncodingInfo", encoding_info_type) != 0) {
+    return -1;
+  }
+  PyObject *compressions;
+  if ((compressions = orc__build_compressions()) == NULL ||
+      PyModule_AddObject(mod, "compressions", compressions) != 0) {
+    Py_XDECREF(compressions);
+    return -1;
+  }
+  Py_INCREF(metadata_type);
+  return PyModule_AddObject(mod, "OrcMetadata", metadata_type);
+}
+
+#if PY_MAJOR_VERSION >= 3
+static struct PyModuleDef module_definition = {
+  PyModuleDef_HEAD_INIT, "_orc_metadata", module_docstring, -1, module_methods
+};
+
+PyMODINIT_FUNC PyInit__orc_metadata(void) {
+  PyObject *mod;
+  if ((mod = PyModule_Create(&module_definition)) == NULL) {
+    return NULL;
+  }
+  if (orc__init_module(mod) != 0) {
+    Py_DECREF(mod);
+    return NULL;
+  }
+  return mod;
+}
+#else
 PyMODINIT_FUNC init_orc_metadata(void) {
   PyObject *mod;
   mod = Py_InitModule3("_orc_metadata", module_methods, module_docstring);
   if (mod == NULL)
     return;
-  
-  ORCReadException = PyErr_NewException("_orc_metadata.ORCReadException", NULL, NULL);
-  Py_INCREF(ORCReadException);
-  PyModule_AddObject(mod, "ORCReadException", ORCReadException);
+
+  orc__init_module(mod);
 }
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+#include <stdlib.h>
+#include <stdint.h>
+#include "core.h"
+
+
+/* Size of the first block, every further block is twice the size of the previous one up to the maximum */
+#define ORC__ARENA_BLOCK_SIZE      32768
+#define ORC__ARENA_MAX_BLOCK_SIZE  4194304
+
+#define ORC__ARENA_ALIGNMENT       16
+
+
+typedef struct orc__arena_block_t {
+  struct orc__arena_block_t *next;
+  size_t size;
+  size_t used;
+} orc__arena_block_t;
+
+
+/* Bump pointer allocator, everything allocated from it is released at once by reset or free.
+ * The embedded allocator lets protobuf-c unpack messages into it, its free is a no-op. */
+typedef struct orc__arena_t {
+  ProtobufCAllocator allocator;
+  orc__arena_block_t *head;
+  size_t next_block_size;
+
+  /* Number of blocks requested from malloc over the lifetime of the arena */
+  size_t allocations;
+} orc__arena_t;
+
+void *orc__arena__alloc(orc__arena_t *arena, size_t size);
+
+
+/* Block headers are padded so that the data following them stays aligned */
+#define ORC__ARENA_HEADER_SIZE \
+  ((sizeof(orc__arena_block_t)+ORC__ARENA_ALIGNMENT-1) & ~((size_t) ORC__ARENA_ALIGNMENT-1))
+
+
+void *orc__arena__protobuf_alloc(void *allocator_data, size_t size) {
+  return orc__arena__alloc(allocator_data, size);
+}
+
+void orc__arena__protobuf_free(void *allocator_data, void *pointer) {
+}
+
+orc__arena_t *orc__arena__init(void) {
+  orc__arena_t *arena;
+  if ((arena = malloc(sizeof(orc__arena_t))) == NULL) {
+    return NULL;
+  }
+  arena->allocator.alloc = orc__arena__protobuf_alloc;
+  arena->allocator.free = orc__arena__protobuf_free;
+  arena->allocator.allocator_data = arena;
+  arena->head = NULL;
+  arena->next_block_size = ORC__ARENA_BLOCK_SIZE;
+  arena->allocations = 1;
+  return arena;
+}
+
+orc__arena_block_t *orc__arena__block(orc__arena_t *arena, size_t size) {
+  orc__arena_block_t *block;
+  if ((block = malloc(ORC__ARENA_HEADER_SIZE+size)) == NULL) {
+    return NULL;
+  }
+  block->size = size;
+  block->used = 0;
+  arena->allocations += 1;
+  return block;
+}
+
+void *orc__arena__alloc(orc__arena_t *arena, size_t size) {
+  size = (size+ORC__ARENA_ALIGNMENT-1) & ~((size_t) ORC__ARENA_ALIGNMENT-1);
+  if (size == 0) {
+    size = ORC__ARENA_ALIGNMENT;
+  }
+
+  orc__arena_block_t *block = arena->head;
+  if (block == NULL || block->size-block->used < size) {
+    /* Large allocations get a block of their own behind the current one, which keeps serving small ones */
+    if (block != NULL && size > arena->next_block_size/4) {
+      orc__arena_block_t *large;
+      if ((large = orc__arena__block(arena, size)) == NULL) {
+        return NULL;
+      }
+      large->used = size;
+      large->next = block->next;
+      block->next = large;
+      return (uint8_t *) large+ORC__ARENA_HEADER_SIZE;
+    }
+
+    size_t block_size = arena->next_block_size;
+    while (block_size < size) {
+      block_size *= 2;
+    }
+    if ((block = orc__arena__block(arena, block_size)) == NULL) {
+      return NULL;
+    }
+    block->next = arena->head;
+    arena->head = block;
+    if (arena->next_block_size < ORC__ARENA_MAX_BLOCK_SIZE) {
+      arena->next_block_size *= 2;
+    }
+  }
+
+  void *pointer = (uint8_t *) block+ORC__ARENA_HEADER_SIZE+block->used;
+  block->used += size;
+  return pointer;
+}
+
+/* Release everything allocated so far, the most recent block is kept for reuse */
+void orc__arena__reset(orc__arena_t *arena) {
+  if (arena->head == NULL) {
+    return;
+  }
+  orc__arena_block_t *block = arena->head->next;
+  orc__arena_block_t *next;
+  while (block != NULL) {
+    next = block->next;
+    free(block);
+    block = next;
+  }
+  arena->head->next = NULL;
+  arena->head->used = 0;
+}
+
+void orc__arena__free(orc__arena_t *arena) {
+  orc__arena_block_t *block = arena->head;
+  orc__arena_block_t *next;
+  while (block != NULL) {
+    next = block->next;
+    free(block);
+    block = next;
+  }
+  free(arena);
+}
@@ -0,0 +1,413 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include "core.h"
+#include "arena.h"
+#include "reader.h"
+#include "columnar.h"
+
+
+/* Structs of the Arrow C Data Interface, as defined by its specification */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED  1
+#define ARROW_FLAG_NULLABLE            2
+#define ARROW_FLAG_MAP_KEYS_SORTED     4
+
+struct ArrowSchema {
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+  void (*release)(struct ArrowSchema *);
+  void *private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+  void (*release)(struct ArrowArray *);
+  void *private_data;
+};
+
+#endif
+
+
+/* Longest column name, e.g. "18446744073709551615.has null" */
+#define ORC__ARROW_NAME_SIZE  32
+
+
+/* Record batch of flat columns under construction. Everything the exported structs point to lives in one arena,
+ * which is freed once the schema, the array and every child moved out of them were released. */
+typedef struct orc__arrow_t {
+  orc__arena_t *arena;
+  int references;
+  int64_t length;
+
+  struct ArrowSchema **schemas;
+  struct ArrowArray **arrays;
+  const void **buffers;
+  size_t n_children;
+  size_t max_children;
+} orc__arrow_t;
+
+
+orc__arrow_t *orc__arrow__init(int64_t length, size_t max_children) {
+  orc__arena_t *arena;
+  if ((arena = orc__arena__init()) == NULL) {
+    return NULL;
+  }
+
+  orc__arrow_t *batch;
+  if ((batch = orc__arena__alloc(arena, sizeof(orc__arrow_t))) == NULL ||
+      (batch->schemas = orc__arena__alloc(arena, sizeof(struct ArrowSchema *)*max_children)) == NULL ||
+      (batch->arrays = orc__arena__alloc(arena, sizeof(struct ArrowArray *)*max_children)) == NULL ||
+      (batch->buffers = orc__arena__alloc(arena, sizeof(void *))) == NULL) {
+    orc__arena__free(arena);
+    return NULL;
+  }
+  batch->buffers[0] = NULL;
+  batch->arena = arena;
+  batch->references = 0;
+  batch->length = length;
+  batch->n_children = 0;
+  batch->max_children = max_children;
+  return batch;
+}
+
+/* Release a batch which was not exported */
+void orc__arrow__free(orc__arrow_t *batch) {
+  orc__arena__free(batch->arena);
+}
+
+/* Consumers may release the structs from any thread */
+void orc__arrow__unref(orc__arrow_t *batch) {
+  if (__sync_sub_and_fetch(&batch->references, 1) == 0) {
+    orc__arena__free(batch->arena);
+  }
+}
+
+/* Releasing the batch releases the children the consumer did not move out of it */
+void orc__arrow__release_schema(struct ArrowSchema *schema) {
+  orc__arrow_t *batch = schema->private_data;
+  int64_t i;
+  for (i=0; i < schema->n_children; ++i) {
+    if (schema->children[i]->release != NULL) {
+      schema->children[i]->release(schema->children[i]);
+    }
+  }
+  schema->release = NULL;
+  orc__arrow__unref(batch);
+}
+
+void orc__arrow__release_array(struct ArrowArray *array) {
+  orc__arrow_t *batch = array->private_data;
+  int64_t i;
+  for (i=0; i < array->n_children; ++i) {
+    if (array->children[i]->release != NULL) {
+      array->children[i]->release(array->children[i]);
+    }
+  }
+  array->release = NULL;
+  orc__arrow__unref(batch);
+}
+
+/* Add a nullable column of the given format, with n_buffers zeroed buffers of the given sizes for the caller to
+ * fill. A validity bitmap of size 0 is left NULL, which stands for no nulls. NULL if the arena is out of memory. */
+struct ArrowArray *orc__arrow__child(orc__arrow_t *batch, const char *name, const char *format, int64_t n_buffers,
+                                     const size_t *sizes) {
+  struct ArrowSchema *schema;
+  struct ArrowArray *array;
+  char *name_copy;
+  const void **buffers;
+  if (batch->n_children == batch->max_children ||
+      (schema = orc__arena__alloc(batch->arena, sizeof(struct ArrowSchema))) == NULL ||
+      (array = orc__arena__alloc(batch->arena, sizeof(struct ArrowArray))) == NULL ||
+      (name_copy = orc__arena__alloc(batch->arena, strlen(name)+1)) == NULL ||
+      (buffers = orc__arena__alloc(batch->arena, sizeof(void *)*n_buffers)) == NULL) {
+    return NULL;
+  }
+  strcpy(name_copy, name);
+
+  int64_t i;
+  for (i=0; i < n_buffers; ++i) {
+    if (i == 0 && sizes[i] == 0) {
+      buffers[i] = NULL;
+      continue;
+    }
+    if ((buffers[i] = orc__arena__alloc(batch->arena, sizes[i])) == NULL) {
+      return NULL;
+    }
+    memset((void *) buffers[i], 0, sizes[i]);
+  }
+
+  memset(schema, 0, sizeof(struct ArrowSchema));
+  schema->format = format;
+  schema->name = name_copy;
+  schema->flags = ARROW_FLAG_NULLABLE;
+  schema->release = orc__arrow__release_schema;
+  schema->private_data = batch;
+
+  memset(array, 0, sizeof(struct ArrowArray));
+  array->length = batch->length;
+  array->n_buffers = n_buffers;
+  array->buffers = buffers;
+  array->release = orc__arrow__release_array;
+  array->private_data = batch;
+
+  batch->schemas[batch->n_children] = schema;
+  batch->arrays[batch->n_children] = array;
+  batch->n_children += 1;
+  return array;
+}
+
+/* Column of fixed size values without nulls, returning its values */
+void *orc__arrow__values(orc__arrow_t *batch, const char *name, const char *format, size_t value_size) {
+  size_t sizes[2] = {0, value_size*batch->length};
+  struct ArrowArray *array;
+  if ((array = orc__arrow__child(batch, name, format, 2, sizes)) == NULL) {
+    return NULL;
+  }
+  return (void *) array->buffers[1];
+}
+
+/* Point a column at a validity bitmap, counting its nulls */
+void orc__arrow__set_validity(orc__arrow_t *batch, struct ArrowArray *array, uint8_t *validity) {
+  int64_t i;
+  array->buffers[0] = validity;
+  array->null_count = 0;
+  for (i=0; i < batch->length; ++i) {
+    array->null_count += (validity[i/8] >> (i%8) & 1) == 0;
+  }
+}
+
+/* UTF-8 column of the minimum or maximum strings of a column's statistics */
+int orc__arrow__strings(orc__arrow_t *batch, orc__reader_t *reader, const char *name,
+                        Orc__Proto__ColumnStatistics **statistics, int maximum) {
+  int64_t n;
+  const char *value;
+  size_t data_size = 0;
+
+  for (n=0; n < batch->length; ++n) {
+    if ((value = orc__columnar__string(statistics[n], maximum)) != NULL) {
+      data_size += orc__reader__string_length(reader, value);
+    }
+  }
+  if (data_size > INT32_MAX) {
+    return ORC__NODECODE;
+  }
+
+  size_t sizes[3] = {orc__columnar__bitmap_size(batch->length), sizeof(int32_t)*(batch->length+1), data_size};
+  struct ArrowArray *array;
+  if ((array = orc__arrow__child(batch, name, "u", 3, sizes)) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  uint8_t *validity = (uint8_t *) array->buffers[0];
+  int32_t *offsets = (int32_t *) array->buffers[1];
+  char *data = (char *) array->buffers[2];
+  size_t length;
+
+  offsets[0] = 0;
+  for (n=0; n < batch->length; ++n) {
+    length = 0;
+    if ((value = orc__columnar__string(statistics[n], maximum)) != NULL) {
+      length = orc__reader__string_length(reader, value);
+      memcpy(data+offsets[n], value, length);
+      orc__columnar__set_bit(validity, n);
+    }
+    offsets[n+1] = offsets[n]+length;
+  }
+  orc__arrow__set_validity(batch, array, validity);
+  return ORC__OK;
+}
+
+/* Columns "<column>.count", "<column>.has null", and for the kinds that have them "<column>.min", "<column>.max"
+ * and "<column>.sum", out of one statistics per row of the batch */
+int orc__arrow__add_statistics(orc__arrow_t *batch, orc__reader_t *reader, uint64_t column,
+                               Orc__Proto__ColumnStatistics **statistics) {
+  char name[ORC__ARROW_NAME_SIZE];
+  size_t bitmap_size = orc__columnar__bitmap_size(batch->length);
+  size_t sizes[2] = {0, bitmap_size};
+  struct ArrowArray *has_null;
+  orc__columnar_t output;
+  output.kind = orc__columnar__kind(statistics, batch->length);
+
+  snprintf(name, sizeof(name), "%llu.count", (unsigned long long) column);
+  if ((output.count = orc__arrow__values(batch, name, "L", sizeof(uint64_t))) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  /* Booleans are bitmaps just like has_null */
+  snprintf(name, sizeof(name), "%llu.has null", (unsigned long long) column);
+  if ((has_null = orc__arrow__child(batch, name, "b", 2, sizes)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  output.has_null = (uint8_t *) has_null->buffers[1];
+
+  int status;
+  if (output.kind == ORC__COLUMNAR_KIND__STRING || output.kind == ORC__COLUMNAR_KIND__DECIMAL) {
+    orc__columnar__fill(statistics, batch->length, &output);
+    snprintf(name, sizeof(name), "%llu.min", (unsigned long long) column);
+    if ((status = orc__arrow__strings(batch, reader, name, statistics, 0)) != ORC__OK) {
+      return status;
+    }
+    snprintf(name, sizeof(name), "%llu.max", (unsigned long long) column);
+    return orc__arrow__strings(batch, reader, name, statistics, 1);
+  }
+  if (!orc__columnar__numeric(output.kind)) {
+    orc__columnar__fill(statistics, batch->length, &output);
+    return ORC__OK;
+  }
+
+  /* Values are filled as 64 bits and narrowed for dates, which Arrow keeps as 32 bit days */
+  const char *format = output.kind == ORC__COLUMNAR_KIND__DOUBLE ? "g" : "l";
+  if ((output.has_bounds = orc__arena__alloc(batch->arena, bitmap_size)) == NULL ||
+      (output.has_sum = orc__arena__alloc(batch->arena, bitmap_size)) == NULL ||
+      (output.minimum = orc__arena__alloc(batch->arena, sizeof(int64_t)*batch->length)) == NULL ||
+      (output.maximum = orc__arena__alloc(batch->arena, sizeof(int64_t)*batch->length)) == NULL ||
+      (output.sum = orc__arena__alloc(batch->arena, sizeof(int64_t)*batch->length)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__columnar__fill(statistics, batch->length, &output);
+
+  const char *keys[3] = {"min", "max", "sum"};
+  void *values[3] = {output.minimum, output.maximum, output.sum};
+  int i, fields = output.kind == ORC__COLUMNAR_KIND__DATE ? 2 : 3;
+  struct ArrowArray *array;
+  for (i=0; i < fields; ++i) {
+    snprintf(name, sizeof(name), "%llu.%s", (unsigned long long) column, keys[i]);
+    sizes[1] = output.kind == ORC__COLUMNAR_KIND__DATE ? sizeof(int32_t)*batch->length : 0;
+    if ((array = orc__arrow__child(batch, name, output.kind == ORC__COLUMNAR_KIND__DATE ? "tdD" : format, 2,
+                                   sizes)) == NULL) {
+      return ORC__ENOMEM;
+    }
+    orc__arrow__set_validity(batch, array, i < 2 ? output.has_bounds : output.has_sum);
+
+    if (output.kind == ORC__COLUMNAR_KIND__DATE) {
+      int64_t n;
+      for (n=0; n < batch->length; ++n) {
+        ((int32_t *) array->buffers[1])[n] = ((int64_t *) values[i])[n];
+      }
+    }
+    else {
+      array->buffers[1] = values[i];
+    }
+  }
+  return ORC__OK;
+}
+
+/* Hand the batch over as a struct array of its columns, it must not be used afterwards */
+void orc__arrow__export(orc__arrow_t *batch, struct ArrowSchema *schema, struct ArrowArray *array) {
+  memset(schema, 0, sizeof(struct ArrowSchema));
+  schema->format = "+s";
+  schema->name = "";
+  schema->n_children = batch->n_children;
+  schema->children = batch->schemas;
+  schema->release = orc__arrow__release_schema;
+  schema->private_data = batch;
+
+  memset(array, 0, sizeof(struct ArrowArray));
+  array->length = batch->length;
+  array->n_buffers = 1;
+  array->buffers = batch->buffers;
+  array->n_children = batch->n_children;
+  array->children = batch->arrays;
+  array->release = orc__arrow__release_array;
+  array->private_data = batch;
+
+  batch->references = 2*(batch->n_children+1);
+}
+
+/* Stripe table with a row per stripe start+n*step for n below count: "stripe", "offset", "index", "data", "tail"
+ * and "rows", followed by the statistics of the columns in those stripes. The footer stripes and the statistics
+ * of these stripes must have been decoded. */
+int orc__arrow__export_stripes(orc__reader_t *reader, uint64_t *columns, size_t n_columns, ssize_t start,
+                               ssize_t step, size_t count, struct ArrowSchema *schema, struct ArrowArray *array) {
+  orc__arrow_t *batch;
+  if ((batch = orc__arrow__init(count, 6+7*n_columns)) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  int64_t *stripe;
+  uint64_t *offset, *index, *data, *tail, *rows;
+  if ((stripe = orc__arrow__values(batch, "stripe", "l", sizeof(int64_t))) == NULL ||
+      (offset = orc__arrow__values(batch, "offset", "L", sizeof(uint64_t))) == NULL ||
+      (index = orc__arrow__values(batch, "index", "L", sizeof(uint64_t))) == NULL ||
+      (data = orc__arrow__values(batch, "data", "L", sizeof(uint64_t))) == NULL ||
+      (tail = orc__arrow__values(batch, "tail", "L", sizeof(uint64_t))) == NULL ||
+      (rows = orc__arrow__values(batch, "rows", "L", sizeof(uint64_t))) == NULL) {
+    orc__arrow__free(batch);
+    return ORC__ENOMEM;
+  }
+
+  size_t n;
+  Orc__Proto__StripeInformation *information;
+  for (n=0; n < count; ++n) {
+    information = reader->footer->stripes[start+n*step];
+    stripe[n] = start+n*step;
+    offset[n] = information->offset;
+    index[n] = information->indexlength;
+    data[n] = information->datalength;
+    tail[n] = information->footerlength;
+    rows[n] = information->numberofrows;
+  }
+
+  int status = ORC__OK;
+  Orc__Proto__ColumnStatistics **statistics = NULL;
+  if (n_columns > 0 && (statistics = orc__arena__alloc(batch->arena, sizeof(void *)*count)) == NULL) {
+    status = ORC__ENOMEM;
+  }
+  for (n=0; n < n_columns && status == ORC__OK; ++n) {
+    if ((status = orc__columnar__gather(reader, columns[n], start, step, count, statistics)) == ORC__OK) {
+      status = orc__arrow__add_statistics(batch, reader, columns[n], statistics);
+    }
+  }
+
+  if (status != ORC__OK) {
+    orc__arrow__free(batch);
+    return status;
+  }
+  orc__arrow__export(batch, schema, array);
+  return ORC__OK;
+}
+
+/* Single row of the file statistics of the columns, which must have been decoded */
+int orc__arrow__export_file_statistics(orc__reader_t *reader, uint64_t *columns, size_t n_columns,
+                                       struct ArrowSchema *schema, struct ArrowArray *array) {
+  orc__arrow_t *batch;
+  if ((batch = orc__arrow__init(1, 7*n_columns)) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  size_t n;
+  int status = ORC__OK;
+  Orc__Proto__ColumnStatistics *statistics;
+  for (n=0; n < n_columns && status == ORC__OK; ++n) {
+    if (columns[n] >= reader->footer->n_statistics || (statistics = reader->footer->statistics[columns[n]]) == NULL) {
+      status = ORC__NOSTREAM;
+    }
+    else {
+      status = orc__arrow__add_statistics(batch, reader, columns[n], &statistics);
+    }
+  }
+
+  if (status != ORC__OK) {
+    orc__arrow__free(batch);
+    return status;
+  }
+  orc__arrow__export(batch, schema, array);
+  return ORC__OK;
+}
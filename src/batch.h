@@ -0,0 +1,256 @@
+#pragma once
+#include <pthread.h>
+#include <sys/types.h>
+#include "core.h"
+#include "arena.h"
+#include "reader.h"
+
+
+/* Decoded files a batch holds per thread before the pool waits for the caller to take them */
+#define ORC__BATCH_PENDING_PER_THREAD  2
+
+
+typedef struct orc__batch_file_t {
+  const char *path;
+
+  /* NULL when the file could not be opened, err then holds the errno */
+  orc__reader_t *reader;
+  int err;
+  int status;
+
+  /* Stripes whose statistics were decoded, start+n*step for n below stripe_count */
+  ssize_t stripe_start;
+  ssize_t stripe_step;
+  ssize_t stripe_count;
+} orc__batch_file_t;
+
+
+/* Reads many files on a pool of threads, each with its own reader. Files are handed out in order and
+ * queued for the caller in completion order once decoded, the caller takes them one at a time with
+ * orc__batch__next and releases their readers. */
+typedef struct orc__batch_t {
+  /* Holds the batch itself, the file and completion arrays and the threads */
+  orc__arena_t *arena;
+
+  orc__batch_file_t *files;
+  size_t n_files;
+  size_t next_file;
+
+  /* Indexes of decoded files in completion order, the caller has taken the first n_taken */
+  size_t *completed;
+  size_t n_completed;
+  size_t n_taken;
+
+  int use_mmap;
+  int enable_schema;
+  int enable_file_stats;
+  int enable_stripe_stats;
+  int enable_stripes;
+  int decompress_threads;
+
+  /* Columns whose statistics are decoded, all of them when NULL */
+  uint64_t *columns;
+  size_t n_columns;
+
+  /* Slice of the stripes to decode the statistics of, bounds as unpacked by PySlice_Unpack */
+  int has_stripe_range;
+  ssize_t stripe_range_start;
+  ssize_t stripe_range_stop;
+  ssize_t stripe_range_step;
+
+  /* Threads the pool is sized for, n_threads of them were started */
+  pthread_t *threads;
+  int max_threads;
+  int n_threads;
+  int stopped;
+  pthread_mutex_t lock;
+  pthread_cond_t completed_cond;
+  pthread_cond_t taken_cond;
+} orc__batch_t;
+
+
+orc__batch_t *orc__batch__init(size_t n_files, int threads) {
+  orc__arena_t *arena;
+  if ((arena = orc__arena__init()) == NULL) {
+    return NULL;
+  }
+
+  orc__batch_t *batch;
+  if ((batch = orc__arena__alloc(arena, sizeof(orc__batch_t))) == NULL) {
+    orc__arena__free(arena);
+    return NULL;
+  }
+  memset(batch, 0, sizeof(orc__batch_t));
+  batch->arena = arena;
+  batch->n_files = n_files;
+  batch->decompress_threads = 1;
+  batch->max_threads = threads < 1 ? 1 : threads;
+  if ((size_t) batch->max_threads > n_files && n_files > 0) {
+    batch->max_threads = n_files;
+  }
+
+  if ((batch->files = orc__arena__alloc(arena, sizeof(orc__batch_file_t)*n_files)) == NULL ||
+      (batch->completed = orc__arena__alloc(arena, sizeof(size_t)*n_files)) == NULL ||
+      (batch->threads = orc__arena__alloc(arena, sizeof(pthread_t)*batch->max_threads)) == NULL) {
+    orc__arena__free(arena);
+    return NULL;
+  }
+  memset(batch->files, 0, sizeof(orc__batch_file_t)*n_files);
+  pthread_mutex_init(&batch->lock, NULL);
+  pthread_cond_init(&batch->completed_cond, NULL);
+  pthread_cond_init(&batch->taken_cond, NULL);
+  return batch;
+}
+
+/* Resolve the stripe range against the number of stripes, the way PySlice_AdjustIndices does */
+ssize_t orc__batch__slice(ssize_t length, ssize_t *start, ssize_t *stop, ssize_t step) {
+  if (*start < 0) {
+    *start += length;
+    if (*start < 0) {
+      *start = step < 0 ? -1 : 0;
+    }
+  }
+  else if (*start >= length) {
+    *start = step < 0 ? length-1 : length;
+  }
+
+  if (*stop < 0) {
+    *stop += length;
+    if (*stop < 0) {
+      *stop = step < 0 ? -1 : 0;
+    }
+  }
+  else if (*stop >= length) {
+    *stop = step < 0 ? length-1 : length;
+  }
+
+  if (step < 0) {
+    return *stop < *start ? (*start-*stop-1)/(-step)+1 : 0;
+  }
+  return *start < *stop ? (*stop-*start-1)/step+1 : 0;
+}
+
+/* Open and decode one file, the reader is kept for the caller even when decoding failed */
+void orc__batch__read(orc__batch_t *batch, orc__batch_file_t *file) {
+  orc__reader_t *reader;
+  if (batch->use_mmap) {
+    reader = orc__reader__init_mmap(file->path, batch->enable_stripe_stats, batch->enable_stripes);
+  }
+  else {
+    reader = orc__reader__init(file->path, batch->enable_stripe_stats, batch->enable_stripes);
+  }
+  if (reader == NULL) {
+    file->err = errno;
+    return;
+  }
+  file->reader = reader;
+
+  if (batch->columns != NULL &&
+      (file->status = orc__reader__select_columns(reader, batch->columns, batch->n_columns)) != ORC__OK) {
+    return;
+  }
+
+  reader->enable_schema = batch->enable_schema;
+  reader->enable_file_stats = batch->enable_file_stats;
+  reader->decompress_threads = batch->decompress_threads;
+  reader->string_views = 1;
+  if ((file->status = orc__reader__decode(reader)) != ORC__OK || !batch->enable_stripe_stats) {
+    return;
+  }
+
+  ssize_t stop = reader->metadata->n_stripestats;
+  file->stripe_start = 0;
+  file->stripe_step = 1;
+  if (batch->has_stripe_range) {
+    file->stripe_start = batch->stripe_range_start;
+    file->stripe_step = batch->stripe_range_step;
+    stop = batch->stripe_range_stop;
+  }
+  file->stripe_count = orc__batch__slice(reader->metadata->n_stripestats, &file->stripe_start, &stop,
+                                         file->stripe_step);
+
+  ssize_t n;
+  for (n=0; n < file->stripe_count && file->status == ORC__OK; ++n) {
+    file->status = orc__reader__decode_stripe_statistics(reader, file->stripe_start+n*file->stripe_step);
+  }
+}
+
+/* Worker taking files in order until none are left, waiting while too many are pending for the caller */
+void *orc__batch__worker(void *arg) {
+  orc__batch_t *batch = arg;
+  size_t index;
+  size_t max_pending = ORC__BATCH_PENDING_PER_THREAD*batch->max_threads;
+
+  for (;;) {
+    pthread_mutex_lock(&batch->lock);
+    while (!batch->stopped && batch->next_file < batch->n_files &&
+           batch->next_file-batch->n_taken >= max_pending) {
+      pthread_cond_wait(&batch->taken_cond, &batch->lock);
+    }
+    if (batch->stopped || batch->next_file == batch->n_files) {
+      pthread_mutex_unlock(&batch->lock);
+      return NULL;
+    }
+    index = batch->next_file++;
+    pthread_mutex_unlock(&batch->lock);
+
+    orc__batch__read(batch, &batch->files[index]);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->completed[batch->n_completed++] = index;
+    pthread_cond_signal(&batch->completed_cond);
+    pthread_mutex_unlock(&batch->lock);
+  }
+}
+
+/* Start the pool, which may end up with fewer threads than requested but not with none */
+int orc__batch__start(orc__batch_t *batch) {
+  int i, started = 0;
+  for (i=0; i < batch->max_threads; ++i) {
+    if (pthread_create(&batch->threads[started], NULL, orc__batch__worker, batch) != 0) {
+      break;
+    }
+    started++;
+  }
+  batch->n_threads = started;
+  return started > 0 || batch->n_files == 0 ? ORC__OK : ORC__ENOMEM;
+}
+
+/* Wait for the next decoded file, in completion order. ORC__NOSTREAM once every file was taken. */
+int orc__batch__next(orc__batch_t *batch, size_t *index) {
+  pthread_mutex_lock(&batch->lock);
+  if (batch->n_taken == batch->n_files) {
+    pthread_mutex_unlock(&batch->lock);
+    return ORC__NOSTREAM;
+  }
+  while (batch->n_taken == batch->n_completed) {
+    pthread_cond_wait(&batch->completed_cond, &batch->lock);
+  }
+  *index = batch->completed[batch->n_taken++];
+  pthread_cond_broadcast(&batch->taken_cond);
+  pthread_mutex_unlock(&batch->lock);
+  return ORC__OK;
+}
+
+/* Stop the pool, files not taken yet are dropped along with their readers */
+void orc__batch__free(orc__batch_t *batch) {
+  int i;
+  pthread_mutex_lock(&batch->lock);
+  batch->stopped = 1;
+  pthread_cond_broadcast(&batch->taken_cond);
+  pthread_mutex_unlock(&batch->lock);
+  for (i=0; i < batch->n_threads; ++i) {
+    pthread_join(batch->threads[i], NULL);
+  }
+
+  size_t j;
+  for (j=batch->n_taken; j < batch->n_completed; ++j) {
+    if (batch->files[batch->completed[j]].reader != NULL) {
+      orc__reader__free(batch->files[batch->completed[j]].reader);
+    }
+  }
+  pthread_mutex_destroy(&batch->lock);
+  pthread_cond_destroy(&batch->completed_cond);
+  pthread_cond_destroy(&batch->taken_cond);
+  orc__arena__free(batch->arena);
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include <string.h>
+#include "arena.h"
 
 
 typedef struct orc__buffer_t {
@@ -9,32 +11,29 @@ typedef struct orc__buffer_t {
 } orc__buffer_t;
 
 
-orc__buffer_t * orc__buffer__init(size_t size) {
+/* Buffers live in the arena and are released along with it */
+orc__buffer_t * orc__buffer__init(orc__arena_t *arena, size_t size) {
   orc__buffer_t *buf; 
 
-  if ((buf = malloc(sizeof(orc__buffer_t))) == NULL) { 
+  if ((buf = orc__arena__alloc(arena, sizeof(orc__buffer_t))) == NULL) { 
     return NULL; 
   }
 
-  if ((buf->head = malloc(size)) == NULL) { 
+  /* Not zeroed, callers only read back what they wrote */
+  if ((buf->head = orc__arena__alloc(arena, size)) == NULL) { 
     return NULL; 
   }
 
-  int i;
-  for (i=0; i<size; i++) {
-    buf->head[i] = 0;
-  }
-
   buf->ptr = buf->head;
   buf->size = 0;
   buf->wraps_stream = 0;
   return buf;
 }
 
-orc__buffer_t *orc__buffer__init_from_stream(uint8_t *stream) {
+orc__buffer_t *orc__buffer__init_from_stream(orc__arena_t *arena, uint8_t *stream) {
   orc__buffer_t *buf; 
 
-  if ((buf = malloc(sizeof(orc__buffer_t))) == NULL) { 
+  if ((buf = orc__arena__alloc(arena, sizeof(orc__buffer_t))) == NULL) { 
     return NULL; 
   }
 
@@ -63,16 +62,6 @@ void orc__buffer__rewind_shift(orc__buffer_t *buf, size_t size) {
 }
 
 void orc__buffer__append(orc__buffer_t *buf, uint8_t *data, size_t len) {
-  int i;
-  for (i=0; i<len; ++i) {
-    buf->ptr[i] = data[i];
-  }
-  buf->size += len;
-}
-
-void orc__buffer__free(orc__buffer_t *buf) {
-  if (buf->wraps_stream == 0) { 
-    free(buf->head); 
-  }
-  free(buf);
+  memcpy(buf->ptr, data, len);
+  orc__buffer__forward(buf, len);
 }
@@ -0,0 +1,154 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include "core.h"
+#include "reader.h"
+
+
+/* Type of the minimum, maximum and sum arrays, dates are kept as days in int64 like integers. Strings and
+ * decimals have no fixed size minimum and maximum, so only their counts and nulls are filled. */
+#define ORC__COLUMNAR_KIND__NONE     0
+#define ORC__COLUMNAR_KIND__INT      1
+#define ORC__COLUMNAR_KIND__DOUBLE   2
+#define ORC__COLUMNAR_KIND__DATE     3
+#define ORC__COLUMNAR_KIND__STRING   4
+#define ORC__COLUMNAR_KIND__DECIMAL  5
+
+
+/* Statistics of one column over a run of stripes, one array entry per stripe. Bitmaps hold one bit per
+ * stripe, least significant bit first. minimum, maximum and sum hold int64_t for INT and DATE and double for
+ * DOUBLE, they are left alone for other kinds. Every array is owned by the caller. */
+typedef struct orc__columnar_t {
+  int kind;
+  uint64_t *count;
+  uint8_t *has_null;
+
+  /* Set when both the minimum and maximum of the stripe are known */
+  uint8_t *has_bounds;
+  uint8_t *has_sum;
+  void *minimum;
+  void *maximum;
+  void *sum;
+} orc__columnar_t;
+
+
+size_t orc__columnar__bitmap_size(size_t n) {
+  return (n+7)/8;
+}
+
+/* Statistics of a column in the stripes start+n*step for n below count, whose statistics must have been
+ * decoded. ORC__NOSTREAM if the column has no statistics in one of them, e.g. when it was not selected. */
+int orc__columnar__gather(orc__reader_t *reader, uint64_t column, ssize_t start, ssize_t step, size_t count,
+                          Orc__Proto__ColumnStatistics **output) {
+  Orc__Proto__StripeStatistics *stripe;
+  size_t n;
+  for (n=0; n < count; ++n) {
+    if ((size_t) (start+n*step) >= reader->metadata->n_stripestats) {
+      return ORC__NOSTREAM;
+    }
+    stripe = reader->metadata->stripestats[start+n*step];
+    if (stripe == NULL || column >= stripe->n_colstats || stripe->colstats[column] == NULL) {
+      return ORC__NOSTREAM;
+    }
+    output[n] = stripe->colstats[column];
+  }
+  return ORC__OK;
+}
+
+/* Kind of the arrays of a column, taken from the first statistics which have one */
+int orc__columnar__kind(Orc__Proto__ColumnStatistics **statistics, size_t count) {
+  size_t n;
+  for (n=0; n < count; ++n) {
+    if (statistics[n]->intstatistics != NULL) {
+      return ORC__COLUMNAR_KIND__INT;
+    }
+    if (statistics[n]->doublestatistics != NULL) {
+      return ORC__COLUMNAR_KIND__DOUBLE;
+    }
+    if (statistics[n]->datestatistics != NULL) {
+      return ORC__COLUMNAR_KIND__DATE;
+    }
+    if (statistics[n]->stringstatistics != NULL) {
+      return ORC__COLUMNAR_KIND__STRING;
+    }
+    if (statistics[n]->decimalstatistics != NULL) {
+      return ORC__COLUMNAR_KIND__DECIMAL;
+    }
+  }
+  return ORC__COLUMNAR_KIND__NONE;
+}
+
+/* Minimum or maximum of string and decimal statistics, NULL when it is not known */
+const char *orc__columnar__string(Orc__Proto__ColumnStatistics *statistics, int maximum) {
+  if (statistics->stringstatistics != NULL) {
+    return maximum ? statistics->stringstatistics->maximum : statistics->stringstatistics->minimum;
+  }
+  if (statistics->decimalstatistics != NULL) {
+    return maximum ? statistics->decimalstatistics->maximum : statistics->decimalstatistics->minimum;
+  }
+  return NULL;
+}
+
+int orc__columnar__numeric(int kind) {
+  return kind == ORC__COLUMNAR_KIND__INT || kind == ORC__COLUMNAR_KIND__DOUBLE || kind == ORC__COLUMNAR_KIND__DATE;
+}
+
+void orc__columnar__set_bit(uint8_t *bitmap, size_t n) {
+  bitmap[n/8] |= 1 << (n%8);
+}
+
+/* Fill the arrays of output, whose kind was set by orc__columnar__kind over the same statistics */
+void orc__columnar__fill(Orc__Proto__ColumnStatistics **statistics, size_t count, orc__columnar_t *output) {
+  size_t n;
+
+  memset(output->has_null, 0, orc__columnar__bitmap_size(count));
+  if (orc__columnar__numeric(output->kind)) {
+    memset(output->has_bounds, 0, orc__columnar__bitmap_size(count));
+    memset(output->has_sum, 0, orc__columnar__bitmap_size(count));
+    memset(output->minimum, 0, sizeof(int64_t)*count);
+    memset(output->maximum, 0, sizeof(int64_t)*count);
+    memset(output->sum, 0, sizeof(int64_t)*count);
+  }
+
+  for (n=0; n < count; ++n) {
+    output->count[n] = statistics[n]->numberofvalues;
+    if (statistics[n]->hasnull) {
+      orc__columnar__set_bit(output->has_null, n);
+    }
+
+    /* Stripes whose statistics are of another kind than the first one keep their bounds and sum unset */
+    if (output->kind == ORC__COLUMNAR_KIND__INT && statistics[n]->intstatistics != NULL) {
+      Orc__Proto__IntegerStatistics *ints = statistics[n]->intstatistics;
+      ((int64_t *) output->minimum)[n] = ints->minimum;
+      ((int64_t *) output->maximum)[n] = ints->maximum;
+      ((int64_t *) output->sum)[n] = ints->sum;
+      if (ints->has_minimum && ints->has_maximum) {
+        orc__columnar__set_bit(output->has_bounds, n);
+      }
+      if (ints->has_sum) {
+        orc__columnar__set_bit(output->has_sum, n);
+      }
+    }
+    else if (output->kind == ORC__COLUMNAR_KIND__DOUBLE && statistics[n]->doublestatistics != NULL) {
+      Orc__Proto__DoubleStatistics *doubles = statistics[n]->doublestatistics;
+      ((double *) output->minimum)[n] = doubles->minimum;
+      ((double *) output->maximum)[n] = doubles->maximum;
+      ((double *) output->sum)[n] = doubles->sum;
+      if (doubles->has_minimum && doubles->has_maximum) {
+        orc__columnar__set_bit(output->has_bounds, n);
+      }
+      if (doubles->has_sum) {
+        orc__columnar__set_bit(output->has_sum, n);
+      }
+    }
+    else if (output->kind == ORC__COLUMNAR_KIND__DATE && statistics[n]->datestatistics != NULL) {
+      Orc__Proto__DateStatistics *dates = statistics[n]->datestatistics;
+      ((int64_t *) output->minimum)[n] = dates->minimum;
+      ((int64_t *) output->maximum)[n] = dates->maximum;
+      if (dates->has_minimum && dates->has_maximum) {
+        orc__columnar__set_bit(output->has_bounds, n);
+      }
+    }
+  }
+}
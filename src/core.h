@@ -53,3 +53,24 @@
 #define ORC__COLUMN_ENCODING_KIND__DICTIONARY     ORC__PROTO__COLUMN_ENCODING__KIND__DICTIONARY
 #define ORC__COLUMN_ENCODING_KIND__DIRECT_V2      ORC__PROTO__COLUMN_ENCODING__KIND__DIRECT_V2
 #define ORC__COLUMN_ENCODING_KIND__DICTIONARY_V2  ORC__PROTO__COLUMN_ENCODING__KIND__DICTIONARY_V2
+
+
+/* Names of the enums by value, NULL for the dictionary encodings which are named along with their size */
+#define ORC__COMPRESSION_KINDS  6
+#define ORC__STREAM_KINDS       9
+#define ORC__ENCODING_KINDS     4
+#define ORC__WRITER_VERSIONS    7
+
+const char *orc__compression_names[ORC__COMPRESSION_KINDS] = {
+  "NONE", "ZLIB", "SNAPPY", "LZO", "LZ4", "ZSTD"
+};
+const char *orc__stream_kind_names[ORC__STREAM_KINDS] = {
+  "PRESENT", "DATA", "LENGTH", "DICTIONARY_DATA", "DICTIONARY_COUNT", "SECONDARY", "ROW_INDEX", "BLOOM_FILTER",
+  "BLOOM_FILTER_UTF8"
+};
+const char *orc__encoding_names[ORC__ENCODING_KINDS] = {
+  "DIRECT", NULL, "DIRECT_V2", NULL
+};
+const char *orc__writer_version_names[ORC__WRITER_VERSIONS] = {
+  "original", "HIVE-8732", "HIVE-4243", "HIVE-12055", "HIVE-13083", "ORC-101", "ORC-135"
+};
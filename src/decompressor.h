@@ -1,51 +1,90 @@
+#pragma once
+#include <pthread.h>
 #include "core.h"
+#include "arena.h"
 #include "inflate.h"
 #include "buffer.h"
 
 
+/* Sections with fewer chunks are always decompressed on the calling thread */
+#define ORC__PARALLEL_MIN_CHUNKS  8
+
+/* Most threads the shared decompression pool starts, however many a reader asks for */
+#define ORC__POOL_MAX_THREADS     64
+
+/* Chunks of codecs which do not store their uncompressed length are first given this many times their
+ * compressed size when decompressed on the calling thread, the output grows up to the compression block size
+ * for those needing more. Chunks decompressed in parallel are given the whole block size up front. */
+#define ORC__INFLATE_RATIO        4
+
+
 typedef struct orc__block_t {
   size_t size;
-  uint8_t is_compressed;
+  uint8_t is_original;
 } orc__block_t;
 
 
+/* Location of a chunk in the section and of its decompressed bytes in the output */
+typedef struct orc__chunk_t {
+  uint8_t *input;
+  size_t size;
+  uint8_t is_original;
+  uint64_t output_offset;
+  uint64_t output_capacity;
+  uint64_t output_size;
+} orc__chunk_t;
+
+
 typedef struct orc__decompressor_t {
+  /* Holds the decompressor itself and its output, which stay valid until the arena is released */
+  orc__arena_t *arena;
+
   orc__buffer_t *input;
   orc__buffer_t *output;
 
   uint8_t compression_kind;
+  uint64_t compression_block_size;
   uint64_t size;
   uint64_t output_buffer_size;
 
   orc__block_t *current_block;
+  orc__inflate_context_t *inflate_context;
+
+  /* Number of threads chunks may be decompressed on */
+  int threads;
 } orc__decompressor_t;
 
 
-orc__decompressor_t *orc__decompressor_init(uint8_t compression_kind, uint64_t compression_block_size, 
-                                            uint8_t *compressed_stream, uint64_t size) {
+orc__decompressor_t *orc__decompressor_init(orc__arena_t *arena, uint8_t compression_kind, 
+                                            uint64_t compression_block_size, uint8_t *compressed_stream, 
+                                            uint64_t size) {
   orc__decompressor_t *decomp;
-  if ((decomp = malloc(sizeof(orc__decompressor_t))) == NULL) { 
+  if ((decomp = orc__arena__alloc(arena, sizeof(orc__decompressor_t))) == NULL) { 
     return NULL; 
   }
 
+  decomp->arena = arena;
   decomp->compression_kind = compression_kind;
+  decomp->compression_block_size = compression_block_size;
   decomp->size = size;
-  decomp->input = orc__buffer__init_from_stream(compressed_stream);
-
-  if (size > compression_block_size) {
-    decomp->output_buffer_size = size;
-  } else {
-    decomp->output_buffer_size = compression_block_size;
+  if ((decomp->input = orc__buffer__init_from_stream(arena, compressed_stream)) == NULL) {
+    return NULL;
   }
 
-  if ((decomp->current_block = malloc(sizeof(orc__block_t))) == NULL) { 
-    return NULL; 
+  if ((decomp->inflate_context = orc__inflate__context()) == NULL) {
+    return NULL;
   }
 
-  if ((decomp->output = orc__buffer__init(decomp->output_buffer_size)) == NULL) { 
+  decomp->output_buffer_size = 0;
+  decomp->threads = 1;
+
+  if ((decomp->current_block = orc__arena__alloc(arena, sizeof(orc__block_t))) == NULL) { 
     return NULL; 
   }
 
+  /* Allocated by decode from the size scanned, unless the section can be passed through from the input */
+  decomp->output = NULL;
+
   return decomp;
 }
 
@@ -54,76 +93,410 @@ void orc__decompressor__decode_header(orc__decompressor_t *decomp) {
   uint32_t header = block[0];
   header |= block[1] << 8;
   header |= block[2] << 16;
-  decomp->current_block->is_compressed = header & 1;
+  decomp->current_block->is_original = header & 1;
   decomp->current_block->size = header >> 1;
   orc__buffer__forward(decomp->input, ORC__BLOCK_HEADER_SIZE);
 }
 
-uint8_t orc__decompressor__decode(orc__decompressor_t *decomp) {
-  if (decomp->compression_kind == ORC__COMPRESSION_KIND__NONE) {
-    orc__buffer__append(decomp->output, decomp->input->ptr, decomp->size);
-    return ORC__DECOMPRESS_OK;
+/* Point the output at the input bytes instead of copying them */
+uint8_t orc__decompressor__passthrough(orc__decompressor_t *decomp, uint8_t *stream, size_t size) {
+  if ((decomp->output = orc__buffer__init_from_stream(decomp->arena, stream)) == NULL) {
+    return ORC__DECOMPRESS_ERR;
   }
+  orc__buffer__forward(decomp->output, size);
+  return ORC__DECOMPRESS_OK;
+}
 
-  orc__inflate_result_t *result = malloc(sizeof(orc__inflate_result_t));
-  result->max_output = decomp->output_buffer_size;
+/* Index the chunks of the section and estimate its decompressed size. The size comes from the chunk headers 
+ * and the codecs which store the uncompressed length, chunks of other codecs are estimated from their 
+ * compressed size and may turn out larger, up to the compression block size. With whole_blocks they are
+ * given the block size instead, which they cannot exceed. chunks may be NULL to only count them. */
+uint8_t orc__decompressor__scan(orc__decompressor_t *decomp, orc__chunk_t *chunks, uint8_t whole_blocks,
+                                uint64_t *n_chunks, uint64_t *output_size) {
+  uint8_t *block;
+  uint64_t offset = 0;
+  uint64_t chunk_size;
+  size_t length;
 
-  int compression_found = 0;
-  while (decomp->input->size < decomp->size) {
-    orc__decompressor__decode_header(decomp);
+  *n_chunks = 0;
+  *output_size = 0;
+  while (offset < decomp->size) {
+    if (decomp->size-offset < ORC__BLOCK_HEADER_SIZE) {
+      return ORC__DECOMPRESS_ERR;
+    }
+    block = decomp->input->head+offset;
+    chunk_size = (block[0] | block[1] << 8 | block[2] << 16) >> 1;
+    offset += ORC__BLOCK_HEADER_SIZE;
 
-    if (decomp->current_block->is_compressed == 1) { 
-      orc__buffer__append(decomp->output, decomp->input->ptr, decomp->current_block->size); 
+    if (chunk_size > decomp->size-offset) {
+      return ORC__DECOMPRESS_ERR;
     }
-    else {
-      result->output = decomp->output->ptr;
-      result->size = decomp->current_block->size;
 
+    length = chunk_size*ORC__INFLATE_RATIO;
+    if (whole_blocks || length > decomp->compression_block_size) {
+      length = decomp->compression_block_size;
+    }
+    if (block[0] & 1) {
+      length = chunk_size;
+    }
 #ifdef HAS_SNAPPY
-      if (decomp->compression_kind == ORC__COMPRESSION_KIND__SNAPPY) { 
-        compression_found = 1;
-        orc__inflate__snappy(decomp->input->ptr, decomp->current_block->size, result); 
+    else if (decomp->compression_kind == ORC__COMPRESSION_KIND__SNAPPY) {
+      if (snappy_uncompressed_length((char *) block+ORC__BLOCK_HEADER_SIZE, chunk_size, &length) != SNAPPY_OK) {
+        return ORC__DECOMPRESS_ERR;
+      }
+    }
+#endif
+#ifdef HAS_ZSTD
+    else if (decomp->compression_kind == ORC__COMPRESSION_KIND__ZSTD) {
+      if (orc__inflate__zstd_length(block+ORC__BLOCK_HEADER_SIZE, chunk_size, &length) != ORC__DECOMPRESS_OK) {
+        return ORC__DECOMPRESS_ERR;
       }
+    }
+#endif
+
+    if (chunks != NULL) {
+      chunks[*n_chunks].input = block+ORC__BLOCK_HEADER_SIZE;
+      chunks[*n_chunks].size = chunk_size;
+      chunks[*n_chunks].is_original = block[0] & 1;
+      chunks[*n_chunks].output_offset = *output_size;
+      chunks[*n_chunks].output_capacity = length;
+      chunks[*n_chunks].output_size = 0;
+    }
+
+    *n_chunks += 1;
+    *output_size += length;
+    offset += chunk_size;
+  }
+  return ORC__DECOMPRESS_OK;
+}
+
+/* Move the output to a buffer with room for at least size more bytes, at least doubling it */
+uint8_t orc__decompressor__grow(orc__decompressor_t *decomp, uint64_t size) {
+  orc__buffer_t *output;
+  uint64_t output_buffer_size = decomp->output_buffer_size*2;
+  if (output_buffer_size < decomp->output->size+size) {
+    output_buffer_size = decomp->output->size+size;
+  }
+
+  if ((output = orc__buffer__init(decomp->arena, output_buffer_size)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__buffer__append(output, decomp->output->head, decomp->output->size);
+  decomp->output = output;
+  decomp->output_buffer_size = output_buffer_size;
+  return ORC__DECOMPRESS_OK;
+}
+
+/* Decompress a single chunk with the given codec */
+uint8_t orc__decompressor__inflate(uint8_t compression_kind, orc__inflate_context_t *context, 
+                                   uint8_t *input, size_t size, orc__inflate_result_t *result) {
+  uint8_t status = ORC__DECOMPRESS_ERR;
+
+#ifdef HAS_SNAPPY
+  if (compression_kind == ORC__COMPRESSION_KIND__SNAPPY) { 
+    status = orc__inflate__snappy(input, size, result); 
+  }
 #endif
 
 #ifdef HAS_ZLIB
-      if (decomp->compression_kind == ORC__COMPRESSION_KIND__ZLIB) { 
-        compression_found = 1;
-        orc__inflate__zlib(decomp->input->ptr, decomp->current_block->size, result); 
-      }
+  if (compression_kind == ORC__COMPRESSION_KIND__ZLIB) { 
+    status = orc__inflate__zlib(context, input, size, result);
+  }
 #endif
 
 #ifdef HAS_LZO
-      if (decomp->compression_kind == ORC__COMPRESSION_KIND__LZO) { 
-        compression_found = 1;
-        orc__inflate__lzo(decomp->input->ptr, decomp->current_block->size, result); 
-      }
+  if (compression_kind == ORC__COMPRESSION_KIND__LZO) { 
+    status = orc__inflate__lzo(input, size, result); 
+  }
 #endif
 
 #ifdef HAS_LZ4
-      if (decomp->compression_kind == ORC__COMPRESSION_KIND__LZ4) { 
-        compression_found = 1;
-        orc__inflate__lz4(decomp->input->ptr, decomp->current_block->size, result); 
-      }
+  if (compression_kind == ORC__COMPRESSION_KIND__LZ4) { 
+    status = orc__inflate__lz4(input, size, result); 
+  }
 #endif
 
-      if (compression_found == 0) { 
-        return ORC__DECOMPRESS_ERR; 
-      }
+#ifdef HAS_ZSTD
+  if (compression_kind == ORC__COMPRESSION_KIND__ZSTD) { 
+    status = orc__inflate__zstd(context, input, size, result);
+  }
+#endif
+
+  /* Either the codec failed or support for it was not compiled in */
+  return status;
+}
+
+
+/* A section being decompressed on the pool, by the calling thread and by up to helpers pool threads */
+typedef struct orc__parallel_t {
+  orc__decompressor_t *decomp;
+  orc__chunk_t *chunks;
+  uint64_t n_chunks;
+  uint64_t next_chunk;
+  uint8_t status;
+  pthread_mutex_t lock;
+
+  /* Pool threads which may still join the section, and those working on it. Guarded by the pool lock. */
+  size_t helpers;
+  size_t active;
+  struct orc__parallel_t *next;
+} orc__parallel_t;
+
 
-      orc__buffer__forward(decomp->output, result->size);
+/* Threads decompressing the chunks of large sections, shared by every reader of the process. They are started
+ * as sections ask for them and never exit, so each keeps its inflate context across sections and files. */
+typedef struct orc__pool_t {
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+
+  /* Sections waiting for more helpers */
+  orc__parallel_t *queue;
+  size_t n_threads;
+} orc__pool_t;
+
+static orc__pool_t orc__pool = {
+  PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0
+};
+static pthread_once_t orc__pool_once = PTHREAD_ONCE_INIT;
+
+
+/* Worker taking chunks off the shared index until none are left or one failed */
+void orc__decompressor__parallel_worker(orc__parallel_t *parallel) {
+  orc__decompressor_t *decomp = parallel->decomp;
+  orc__inflate_context_t *context = orc__inflate__context();
+  orc__inflate_result_t result;
+  orc__chunk_t *chunk;
+  uint8_t status;
+
+  for (;;) {
+    pthread_mutex_lock(&parallel->lock);
+    if (parallel->next_chunk == parallel->n_chunks || parallel->status != ORC__DECOMPRESS_OK) {
+      pthread_mutex_unlock(&parallel->lock);
+      return;
     }
-    orc__buffer__forward(decomp->input, decomp->current_block->size);
+    chunk = &parallel->chunks[parallel->next_chunk++];
+    pthread_mutex_unlock(&parallel->lock);
+
+    if (chunk->is_original) {
+      memcpy(decomp->output->head+chunk->output_offset, chunk->input, chunk->size);
+      chunk->output_size = chunk->size;
+      continue;
+    }
+
+    status = ORC__DECOMPRESS_ERR;
+    if (context != NULL) {
+      result.output = decomp->output->head+chunk->output_offset;
+      result.size = chunk->size;
+      result.max_output = chunk->output_capacity;
+      status = orc__decompressor__inflate(decomp->compression_kind, context, chunk->input, chunk->size, &result);
+      chunk->output_size = result.size;
+    }
+
+    if (status != ORC__DECOMPRESS_OK) {
+      pthread_mutex_lock(&parallel->lock);
+      parallel->status = status;
+      pthread_mutex_unlock(&parallel->lock);
+      return;
+    }
+  }
+}
+
+void orc__pool__unlink(orc__parallel_t *parallel) {
+  orc__parallel_t **link;
+  for (link=&orc__pool.queue; *link != NULL; link=&(*link)->next) {
+    if (*link == parallel) {
+      *link = parallel->next;
+      return;
+    }
+  }
+}
+
+void *orc__pool__worker(void *arg) {
+  orc__parallel_t *parallel;
+  pthread_mutex_lock(&orc__pool.lock);
+  for (;;) {
+    while (orc__pool.queue == NULL) {
+      pthread_cond_wait(&orc__pool.work_cond, &orc__pool.lock);
+    }
+    parallel = orc__pool.queue;
+    if (--parallel->helpers == 0) {
+      orc__pool__unlink(parallel);
+    }
+    parallel->active += 1;
+    pthread_mutex_unlock(&orc__pool.lock);
+
+    orc__decompressor__parallel_worker(parallel);
+
+    pthread_mutex_lock(&orc__pool.lock);
+    parallel->active -= 1;
+    pthread_cond_broadcast(&orc__pool.done_cond);
+  }
+  return NULL;
+}
+
+/* The threads of the pool do not survive a fork, the child starts over with an empty one */
+void orc__pool__after_fork(void) {
+  pthread_mutex_init(&orc__pool.lock, NULL);
+  pthread_cond_init(&orc__pool.work_cond, NULL);
+  pthread_cond_init(&orc__pool.done_cond, NULL);
+  orc__pool.queue = NULL;
+  orc__pool.n_threads = 0;
+}
+
+void orc__pool__init(void) {
+  pthread_atfork(NULL, NULL, orc__pool__after_fork);
+}
+
+/* Offer a section to up to helpers pool threads, starting threads until the pool has that many. The section
+ * is decompressed by the calling thread alone when none can be started. */
+void orc__pool__submit(orc__parallel_t *parallel, size_t helpers) {
+  pthread_t thread;
+  pthread_once(&orc__pool_once, orc__pool__init);
+
+  pthread_mutex_lock(&orc__pool.lock);
+  if (helpers > ORC__POOL_MAX_THREADS) {
+    helpers = ORC__POOL_MAX_THREADS;
+  }
+  while (orc__pool.n_threads < helpers && pthread_create(&thread, NULL, orc__pool__worker, NULL) == 0) {
+    pthread_detach(thread);
+    orc__pool.n_threads += 1;
+  }
+  parallel->helpers = helpers < orc__pool.n_threads ? helpers : orc__pool.n_threads;
+  parallel->active = 0;
+  if (parallel->helpers > 0) {
+    parallel->next = orc__pool.queue;
+    orc__pool.queue = parallel;
+    pthread_cond_broadcast(&orc__pool.work_cond);
+  }
+  pthread_mutex_unlock(&orc__pool.lock);
+}
+
+/* Withdraw a section the calling thread is done with and wait for the pool threads still working on it */
+void orc__pool__finish(orc__parallel_t *parallel) {
+  pthread_mutex_lock(&orc__pool.lock);
+  if (parallel->helpers > 0) {
+    orc__pool__unlink(parallel);
+    parallel->helpers = 0;
+  }
+  while (parallel->active > 0) {
+    pthread_cond_wait(&orc__pool.done_cond, &orc__pool.lock);
   }
-  free(result);
+  pthread_mutex_unlock(&orc__pool.lock);
+}
+
+/* Decompress the chunks into their own slots of the output on up to decomp->threads threads, 
+ * then close the gaps left by chunks smaller than their slot. Every slot has room for a whole block, so no
+ * chunk has to be decompressed again. */
+uint8_t orc__decompressor__decode_parallel(orc__decompressor_t *decomp, uint64_t n_chunks) {
+  orc__parallel_t parallel;
+  parallel.decomp = decomp;
+  parallel.n_chunks = n_chunks;
+  parallel.next_chunk = 0;
+  parallel.status = ORC__DECOMPRESS_OK;
+
+  if ((parallel.chunks = orc__arena__alloc(decomp->arena, sizeof(orc__chunk_t)*n_chunks)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__decompressor__scan(decomp, parallel.chunks, 1, &n_chunks, &decomp->output_buffer_size);
+  if ((decomp->output = orc__buffer__init(decomp->arena, decomp->output_buffer_size)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  pthread_mutex_init(&parallel.lock, NULL);
+
+  /* The calling thread works through the chunks too */
+  uint64_t n_threads = (uint64_t) decomp->threads < n_chunks ? (uint64_t) decomp->threads : n_chunks;
+  orc__pool__submit(&parallel, n_threads-1);
+  orc__decompressor__parallel_worker(&parallel);
+  orc__pool__finish(&parallel);
+  pthread_mutex_destroy(&parallel.lock);
+
+  if (parallel.status != ORC__DECOMPRESS_OK) {
+    return parallel.status;
+  }
+
+  uint64_t j;
+  for (j=0; j < n_chunks; ++j) {
+    if (decomp->output->size != parallel.chunks[j].output_offset) {
+      memmove(decomp->output->ptr, decomp->output->head+parallel.chunks[j].output_offset, 
+              parallel.chunks[j].output_size);
+    }
+    orc__buffer__forward(decomp->output, parallel.chunks[j].output_size);
+  }
+  orc__buffer__forward(decomp->input, decomp->size);
   return ORC__DECOMPRESS_OK;
 }
 
-void orc__decompressor__free(orc__decompressor_t *decomp) {
-  free(decomp->current_block);
+uint8_t orc__decompressor__decode(orc__decompressor_t *decomp) {
+  if (decomp->compression_kind == ORC__COMPRESSION_KIND__NONE) {
+    return orc__decompressor__passthrough(decomp, decomp->input->ptr, decomp->size);
+  }
+
+  /* A section made of a single original chunk needs no stitching either */
+  if (decomp->size >= ORC__BLOCK_HEADER_SIZE) {
+    orc__decompressor__decode_header(decomp);
+    if (decomp->current_block->is_original && 
+        decomp->current_block->size == decomp->size-ORC__BLOCK_HEADER_SIZE) {
+      return orc__decompressor__passthrough(decomp, decomp->input->ptr, decomp->current_block->size);
+    }
+    orc__buffer__rewind(decomp->input, ORC__BLOCK_HEADER_SIZE);
+  }
+
+  uint64_t n_chunks;
+  if (orc__decompressor__scan(decomp, NULL, 0, &n_chunks, &decomp->output_buffer_size) != ORC__DECOMPRESS_OK) {
+    return ORC__DECOMPRESS_ERR;
+  }
 
-  orc__buffer__free(decomp->input);
-  orc__buffer__free(decomp->output);
+  if (decomp->threads > 1 && n_chunks >= ORC__PARALLEL_MIN_CHUNKS) {
+    return orc__decompressor__decode_parallel(decomp, n_chunks);
+  }
 
-  free(decomp);
+  if ((decomp->output = orc__buffer__init(decomp->arena, decomp->output_buffer_size)) == NULL) { 
+    return ORC__ENOMEM; 
+  }
+
+  orc__inflate_result_t result;
+  uint8_t status;
+
+  while (decomp->input->size < decomp->size) {
+    orc__decompressor__decode_header(decomp);
+
+    if (decomp->current_block->is_original == 1) { 
+      /* Earlier chunks may have taken more than their estimate */
+      if (decomp->current_block->size > decomp->output_buffer_size-decomp->output->size) {
+        if ((status = orc__decompressor__grow(decomp, decomp->current_block->size)) != ORC__DECOMPRESS_OK) {
+          return status;
+        }
+      }
+      orc__buffer__append(decomp->output, decomp->input->ptr, decomp->current_block->size); 
+    }
+    else {
+      result.output = decomp->output->ptr;
+      result.size = decomp->current_block->size;
+      result.max_output = decomp->output_buffer_size-decomp->output->size;
+
+      status = orc__decompressor__inflate(decomp->compression_kind, decomp->inflate_context, decomp->input->ptr, 
+                                          decomp->current_block->size, &result);
+
+      /* Retried once with room for a whole block, which no chunk may exceed */
+      if (status != ORC__DECOMPRESS_OK && result.max_output < decomp->compression_block_size) {
+        if ((status = orc__decompressor__grow(decomp, decomp->compression_block_size)) != ORC__DECOMPRESS_OK) {
+          return status;
+        }
+        result.output = decomp->output->ptr;
+        result.size = decomp->current_block->size;
+        result.max_output = decomp->output_buffer_size-decomp->output->size;
+        status = orc__decompressor__inflate(decomp->compression_kind, decomp->inflate_context, decomp->input->ptr, 
+                                            decomp->current_block->size, &result);
+      }
+
+      if (status != ORC__DECOMPRESS_OK) { 
+        return ORC__DECOMPRESS_ERR; 
+      }
+
+      orc__buffer__forward(decomp->output, result.size);
+    }
+    orc__buffer__forward(decomp->input, decomp->current_block->size);
+  }
+  return ORC__DECOMPRESS_OK;
 }
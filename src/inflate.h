@@ -1,3 +1,5 @@
+#pragma once
+#include <pthread.h>
 #include "core.h"
 
 #ifdef HAS_ZLIB
@@ -16,6 +18,10 @@
 #  include "lz4.h"
 #endif
 
+#ifdef HAS_ZSTD
+#  include "zstd.h"
+#endif
+
 
 typedef struct orc__inflate_result_t {
   size_t size;
@@ -24,12 +30,77 @@ typedef struct orc__inflate_result_t {
 } orc__inflate_result_t;
 
 
+/* Codec state reused across blocks, sections and files decoded on the same thread */
+typedef struct orc__inflate_context_t {
+#ifdef HAS_ZLIB
+  z_stream zlib;
+  int zlib_initialized;
+#endif
+#ifdef HAS_ZSTD
+  ZSTD_DCtx *zstd;
+#endif
+  int unused;
+} orc__inflate_context_t;
+
+
+static pthread_key_t orc__inflate__context_key;
+static pthread_once_t orc__inflate__context_once = PTHREAD_ONCE_INIT;
+
+void orc__inflate__context_free(void *ptr) {
+  orc__inflate_context_t *context = ptr;
+#ifdef HAS_ZLIB
+  if (context->zlib_initialized) {
+    inflateEnd(&context->zlib);
+  }
+#endif
+#ifdef HAS_ZSTD
+  if (context->zstd != NULL) {
+    ZSTD_freeDCtx(context->zstd);
+  }
+#endif
+  free(context);
+}
+
+void orc__inflate__context_key_init(void) {
+  pthread_key_create(&orc__inflate__context_key, orc__inflate__context_free);
+}
+
+/* The calling thread's context, created on first use and freed when the thread exits */
+orc__inflate_context_t *orc__inflate__context(void) {
+  pthread_once(&orc__inflate__context_once, orc__inflate__context_key_init);
+
+  orc__inflate_context_t *context = pthread_getspecific(orc__inflate__context_key);
+  if (context != NULL) {
+    return context;
+  }
+
+  if ((context = malloc(sizeof(orc__inflate_context_t))) == NULL) {
+    return NULL;
+  }
+#ifdef HAS_ZLIB
+  context->zlib_initialized = 0;
+#endif
+#ifdef HAS_ZSTD
+  context->zstd = NULL;
+#endif
+  if (pthread_setspecific(orc__inflate__context_key, context) != 0) {
+    free(context);
+    return NULL;
+  }
+  return context;
+}
+
+
 #ifdef HAS_SNAPPY
   int orc__inflate__snappy(uint8_t *compressed_input, size_t size, orc__inflate_result_t *result) {
     
     if (snappy_uncompressed_length((char *) compressed_input, size, &result->size) != 0) { 
       return ORC__DECOMPRESS_ERR; 
     }
+
+    if (result->size > result->max_output) {
+      return ORC__DECOMPRESS_ERR;
+    }
   
     if (snappy_uncompress((char *) compressed_input, size, (char *) result->output, &result->size) != 0) { 
       return ORC__DECOMPRESS_ERR; 
@@ -40,49 +111,92 @@ typedef struct orc__inflate_result_t {
 #endif
 
 #ifdef HAS_ZLIB
-  int orc__inflate__zlib(uint8_t *compressed_input, size_t size, orc__inflate_result_t *result) {
-    z_stream strm;
-    strm.total_in = size;
-    strm.total_out = result->size;
-    strm.avail_in = size;
-    strm.avail_out = result->max_output;
-    strm.next_in = compressed_input;
-    strm.next_out = result->output;
-  
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-  
-    if (inflateInit2(&strm, -15) != Z_OK) {
-      inflateEnd(&strm);
-      return ORC__DECOMPRESS_ERR;
+  int orc__inflate__zlib(orc__inflate_context_t *context, uint8_t *compressed_input, size_t size, 
+                         orc__inflate_result_t *result) {
+    z_stream *strm = &context->zlib;
+
+    /* The window and inflate state are allocated once per thread and only reset per block */
+    if (context->zlib_initialized) {
+      if (inflateReset(strm) != Z_OK) {
+        return ORC__DECOMPRESS_ERR;
+      }
+    }
+    else {
+      strm->zalloc = Z_NULL;
+      strm->zfree = Z_NULL;
+      strm->opaque = Z_NULL;
+      strm->avail_in = 0;
+      strm->next_in = Z_NULL;
+
+      if (inflateInit2(strm, -15) != Z_OK) {
+        return ORC__DECOMPRESS_ERR;
+      }
+      context->zlib_initialized = 1;
     }
+
+    strm->avail_in = size;
+    strm->avail_out = result->max_output;
+    strm->next_in = compressed_input;
+    strm->next_out = result->output;
   
-    if (inflate(&strm, Z_FINISH) != Z_STREAM_END) {
-      inflateEnd(&strm);
+    if (inflate(strm, Z_FINISH) != Z_STREAM_END) {
       return ORC__DECOMPRESS_ERR;
     }
-    result->size = strm.total_out;
-    inflateEnd(&strm);
+    result->size = strm->total_out;
     return ORC__DECOMPRESS_OK;
   }
 #endif
 
 #ifdef HAS_LZO
   int orc__inflate__lzo(uint8_t *compressed_input, size_t size, orc__inflate_result_t *result) {
-    if (lzo1x_decompress(compressed_input, size, result->output, &result->size, NULL) != LZO_E_OK) { 
+    lzo_uint output_size = result->max_output;
+    if (lzo1x_decompress_safe(compressed_input, size, result->output, &output_size, NULL) != LZO_E_OK) { 
       return ORC__DECOMPRESS_ERR; 
     }
+    result->size = output_size;
     return ORC__DECOMPRESS_OK;
   }
 #endif
 
 #ifdef HAS_LZ4
   int orc__inflate__lz4(uint8_t *compressed_input, size_t size, orc__inflate_result_t *result) {
-    result->size = LZ4_decompress_safe((char *) compressed_input, (char *) result->output, size, result->max_output);
-    if (result->size <= 0) { 
+    int output_size = LZ4_decompress_safe((char *) compressed_input, (char *) result->output, size, result->max_output);
+    if (output_size < 0) { 
       return ORC__DECOMPRESS_ERR; 
     }
+    result->size = output_size;
+    return ORC__DECOMPRESS_OK;
+  }
+#endif
+
+#ifdef HAS_ZSTD
+  int orc__inflate__zstd(orc__inflate_context_t *context, uint8_t *compressed_input, size_t size, 
+                         orc__inflate_result_t *result) {
+    /* Like the zlib stream, the decompression context lives as long as the thread */
+    if (context->zstd == NULL) {
+      if ((context->zstd = ZSTD_createDCtx()) == NULL) {
+        return ORC__DECOMPRESS_ERR;
+      }
+    }
+
+    size_t output_size = ZSTD_decompressDCtx(context->zstd, result->output, result->max_output, 
+                                             compressed_input, size);
+    if (ZSTD_isError(output_size)) {
+      return ORC__DECOMPRESS_ERR;
+    }
+    result->size = output_size;
+    return ORC__DECOMPRESS_OK;
+  }
+
+  /* Uncompressed length stored in the frame header, if the writer recorded it */
+  int orc__inflate__zstd_length(uint8_t *compressed_input, size_t size, size_t *length) {
+    unsigned long long content_size = ZSTD_getFrameContentSize(compressed_input, size);
+    if (content_size == ZSTD_CONTENTSIZE_ERROR) {
+      return ORC__DECOMPRESS_ERR;
+    }
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN) {
+      *length = content_size;
+    }
     return ORC__DECOMPRESS_OK;
   }
 #endif
@@ -0,0 +1,799 @@
+#pragma once
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "core.h"
+#include "reader.h"
+#include "schema.h"
+
+
+/* Output is gathered in blocks of this size, and flushed whenever one fills up when writing to a descriptor */
+#define ORC__JSON_BUFFER_SIZE  65536
+
+/* Deepest nesting of the output, the streams of the stripes are three levels down */
+#define ORC__JSON_MAX_DEPTH    8
+
+/* Most keys of one of the result dicts, and the slots of the largest Python 2 dict table holding them */
+#define ORC__JSON_MAX_KEYS     8
+#define ORC__JSON_TABLE_SIZE   32
+
+/* Ends the order of the keys of a dict when some of them are not present */
+#define ORC__JSON_NO_KEY       0xFF
+
+
+/* JSON written the way json.dumps of Python 2 writes the result of read_metadata, to a descriptor or to
+ * memory. Write errors are sticky, once one happened later output is dropped. */
+typedef struct orc__json_t {
+  char *data;
+  size_t length;
+  size_t capacity;
+
+  /* Flushed to whenever the buffer fills up, the output is kept in memory when negative */
+  int fd;
+
+  /* Spaces per level of nesting, everything is written on one line when 0 */
+  int indent;
+
+  /* Containers being written along with the number of items written to each */
+  int depth;
+  size_t items[ORC__JSON_MAX_DEPTH];
+
+  /* errno of the first failed allocation or write */
+  int error;
+} orc__json_t;
+
+
+/* One of the dicts read_metadata builds, by the keys in the order it inserts them. Python 2 iterates dicts in
+ * the order of their hash table slots, so which keys come first depends on which others are present. orders
+ * holds the output order of the keys for every subset of them, indexed by the bitmask of the keys present and
+ * ended by ORC__JSON_NO_KEY. */
+typedef struct orc__json_shape_t {
+  const char *keys[ORC__JSON_MAX_KEYS];
+  size_t n_keys;
+  uint8_t orders[1 << ORC__JSON_MAX_KEYS][ORC__JSON_MAX_KEYS];
+} orc__json_shape_t;
+
+#define ORC__JSON_METADATA__ROWS               0
+#define ORC__JSON_METADATA__COMPRESSION        1
+#define ORC__JSON_METADATA__VERSION            2
+#define ORC__JSON_METADATA__COMPRESSION_SIZE   3
+#define ORC__JSON_METADATA__SCHEMA             4
+#define ORC__JSON_METADATA__STRIPE_STATISTICS  5
+#define ORC__JSON_METADATA__FILE_STATISTICS    6
+#define ORC__JSON_METADATA__STRIPES            7
+
+#define ORC__JSON_STATISTICS__COLUMN    0
+#define ORC__JSON_STATISTICS__HAS_NULL  1
+#define ORC__JSON_STATISTICS__COUNT     2
+#define ORC__JSON_STATISTICS__MIN       3
+#define ORC__JSON_STATISTICS__MAX       4
+#define ORC__JSON_STATISTICS__SUM       5
+
+#define ORC__JSON_STRIPE_STATISTICS__STRIPE      0
+#define ORC__JSON_STRIPE_STATISTICS__STATISTICS  1
+
+#define ORC__JSON_STRIPE__STRIPE     0
+#define ORC__JSON_STRIPE__OFFSET     1
+#define ORC__JSON_STRIPE__DATA       2
+#define ORC__JSON_STRIPE__ROWS       3
+#define ORC__JSON_STRIPE__TAIL       4
+#define ORC__JSON_STRIPE__INDEX      5
+#define ORC__JSON_STRIPE__STREAMS    6
+#define ORC__JSON_STRIPE__ENCODINGS  7
+
+#define ORC__JSON_STREAM__SECTION  0
+#define ORC__JSON_STREAM__COLUMN   1
+#define ORC__JSON_STREAM__START    2
+#define ORC__JSON_STREAM__LENGTH   3
+
+#define ORC__JSON_ENCODING__ENCODING  0
+#define ORC__JSON_ENCODING__COLUMN    1
+
+orc__json_shape_t orc__json_metadata = {
+  {"rows", "compression", "version", "compression_size", "schema", "Stripe Statistics", "File Statistics",
+   "Stripes"}, 8, {{0}}
+};
+orc__json_shape_t orc__json_statistics = {
+  {"column", "has null", "count", "min", "max", "sum"}, 6, {{0}}
+};
+orc__json_shape_t orc__json_stripe_statistics = {
+  {"stripe", "statistics"}, 2, {{0}}
+};
+orc__json_shape_t orc__json_stripe = {
+  {"stripe", "offset", "data", "rows", "tail", "index", "Streams", "Encodings"}, 8, {{0}}
+};
+orc__json_shape_t orc__json_stream = {
+  {"section", "column", "start", "length"}, 4, {{0}}
+};
+orc__json_shape_t orc__json_encoding = {
+  {"encoding", "column"}, 2, {{0}}
+};
+
+
+/* Hash of a str in Python 2 without hash randomization */
+uint64_t orc__json__py2_hash(const char *value) {
+  size_t n, length = strlen(value);
+  uint64_t x;
+  if (length == 0) {
+    return 0;
+  }
+  x = (uint64_t) (unsigned char) value[0] << 7;
+  for (n=0; n < length; ++n) {
+    x = (1000003*x) ^ (unsigned char) value[n];
+  }
+  x ^= length;
+  return x == (uint64_t) -1 ? (uint64_t) -2 : x;
+}
+
+/* Put a key into the first free slot of its probe sequence, the way Python 2 dicts do */
+void orc__json__py2_insert(int *table, size_t mask, uint64_t hash, int key) {
+  size_t i = hash & mask;
+  uint64_t perturb;
+  for (perturb = hash; table[i & mask] >= 0; perturb >>= 5) {
+    i = (i << 2)+i+perturb+1;
+  }
+  table[i & mask] = key;
+}
+
+/* Order of the keys in present as Python 2 iterates a dict they were inserted into in order. Tables start with
+ * 8 slots and grow to the smallest power of two above four times the keys once two thirds are used. */
+void orc__json__py2_order(orc__json_shape_t *shape, unsigned present, uint8_t *order) {
+  int table[ORC__JSON_TABLE_SIZE], resized[ORC__JSON_TABLE_SIZE];
+  uint64_t hashes[ORC__JSON_MAX_KEYS];
+  size_t i, n, mask = 7, used = 0, size;
+
+  for (i=0; i < ORC__JSON_TABLE_SIZE; ++i) {
+    table[i] = -1;
+  }
+  for (n=0; n < shape->n_keys; ++n) {
+    hashes[n] = orc__json__py2_hash(shape->keys[n]);
+    if (!(present & (1 << n))) {
+      continue;
+    }
+    orc__json__py2_insert(table, mask, hashes[n], n);
+    used += 1;
+
+    if (used*3 >= (mask+1)*2) {
+      for (size=8; size <= 4*used; size <<= 1);
+      for (i=0; i < size; ++i) {
+        resized[i] = -1;
+      }
+      for (i=0; i <= mask; ++i) {
+        if (table[i] >= 0) {
+          orc__json__py2_insert(resized, size-1, hashes[table[i]], table[i]);
+        }
+      }
+      memcpy(table, resized, sizeof(int)*size);
+      mask = size-1;
+    }
+  }
+
+  for (i=0, n=0; i <= mask; ++i) {
+    if (table[i] >= 0) {
+      order[n++] = table[i];
+    }
+  }
+  for (; n < ORC__JSON_MAX_KEYS; ++n) {
+    order[n] = ORC__JSON_NO_KEY;
+  }
+}
+
+void orc__json__init_shape(orc__json_shape_t *shape) {
+  unsigned present;
+  for (present=0; present < (1u << shape->n_keys); ++present) {
+    orc__json__py2_order(shape, present, shape->orders[present]);
+  }
+}
+
+/* Work out the key orders of every shape, once before any output is written */
+void orc__json__init_shapes(void) {
+  orc__json__init_shape(&orc__json_metadata);
+  orc__json__init_shape(&orc__json_statistics);
+  orc__json__init_shape(&orc__json_stripe_statistics);
+  orc__json__init_shape(&orc__json_stripe);
+  orc__json__init_shape(&orc__json_stream);
+  orc__json__init_shape(&orc__json_encoding);
+}
+
+
+/* fd is the descriptor to write to, or -1 to keep the output in memory */
+int orc__json__init(orc__json_t *json, int fd, int indent) {
+  memset(json, 0, sizeof(orc__json_t));
+  json->fd = fd;
+  json->indent = indent;
+  if ((json->data = malloc(ORC__JSON_BUFFER_SIZE)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  json->capacity = ORC__JSON_BUFFER_SIZE;
+  return ORC__OK;
+}
+
+void orc__json__free(orc__json_t *json) {
+  free(json->data);
+  json->data = NULL;
+}
+
+/* Write the buffered output to the descriptor */
+void orc__json__flush(orc__json_t *json) {
+  size_t written = 0;
+  ssize_t n;
+  while (json->error == 0 && written < json->length) {
+    if ((n = write(json->fd, json->data+written, json->length-written)) < 0) {
+      if (errno != EINTR) {
+        json->error = errno;
+      }
+      continue;
+    }
+    written += n;
+  }
+  json->length = 0;
+}
+
+/* Room for size more bytes at the end of the output, NULL once an error happened */
+char *orc__json__reserve(orc__json_t *json, size_t size) {
+  if (json->error != 0) {
+    return NULL;
+  }
+  if (json->length+size > json->capacity && json->fd >= 0) {
+    orc__json__flush(json);
+  }
+  if (json->length+size > json->capacity) {
+    size_t capacity = json->capacity;
+    char *data;
+    while (json->length+size > capacity) {
+      capacity *= 2;
+    }
+    if ((data = realloc(json->data, capacity)) == NULL) {
+      json->error = ENOMEM;
+      return NULL;
+    }
+    json->data = data;
+    json->capacity = capacity;
+  }
+  return json->error == 0 ? json->data+json->length : NULL;
+}
+
+void orc__json__write(orc__json_t *json, const char *value, size_t size) {
+  char *output;
+  if ((output = orc__json__reserve(json, size)) != NULL) {
+    memcpy(output, value, size);
+    json->length += size;
+  }
+}
+
+void orc__json__newline(orc__json_t *json) {
+  char *output;
+  size_t size = 1+json->indent*json->depth;
+  if (json->indent > 0 && (output = orc__json__reserve(json, size)) != NULL) {
+    output[0] = '\n';
+    memset(output+1, ' ', size-1);
+    json->length += size;
+  }
+}
+
+/* Separate an item from the previous one of its container, Python 2 keeps the space before newlines */
+void orc__json__item(orc__json_t *json) {
+  if (json->depth == 0) {
+    return;
+  }
+  if (json->items[json->depth-1]++ > 0) {
+    orc__json__write(json, ", ", 2);
+  }
+  orc__json__newline(json);
+}
+
+void orc__json__begin(orc__json_t *json, char bracket) {
+  orc__json__write(json, &bracket, 1);
+  json->items[json->depth++] = 0;
+}
+
+/* Empty containers are closed on the same line */
+void orc__json__end(orc__json_t *json, char bracket) {
+  json->depth -= 1;
+  if (json->items[json->depth] > 0) {
+    orc__json__newline(json);
+  }
+  orc__json__write(json, &bracket, 1);
+}
+
+/* Keys are plain ASCII and written as they are */
+void orc__json__key(orc__json_t *json, const char *key) {
+  size_t length = strlen(key);
+  char *output;
+  orc__json__item(json);
+  if ((output = orc__json__reserve(json, length+4)) != NULL) {
+    output[0] = '"';
+    memcpy(output+1, key, length);
+    memcpy(output+1+length, "\": ", 3);
+    json->length += length+4;
+  }
+}
+
+void orc__json__int(orc__json_t *json, int64_t value) {
+  char digits[20], *output;
+  uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+  size_t n = sizeof(digits);
+  do {
+    digits[--n] = '0'+magnitude%10;
+    magnitude /= 10;
+  } while (magnitude > 0);
+
+  size_t size = sizeof(digits)-n+(value < 0);
+  if ((output = orc__json__reserve(json, size)) != NULL) {
+    if (value < 0) {
+      *output++ = '-';
+    }
+    memcpy(output, digits+n, sizeof(digits)-n);
+    json->length += size;
+  }
+}
+
+void orc__json__uint(orc__json_t *json, uint64_t value) {
+  char digits[20];
+  size_t n = sizeof(digits);
+  do {
+    digits[--n] = '0'+value%10;
+    value /= 10;
+  } while (value > 0);
+  orc__json__write(json, digits+n, sizeof(digits)-n);
+}
+
+/* Shortest digits that read back as the same double, laid out the way repr lays out floats. The exponent
+ * form is used below 1e-4 and from 1e16 on. */
+void orc__json__double(orc__json_t *json, double value) {
+  char buffer[32], digits[20], output[40];
+  int precision, exponent, decpt, n_digits = 0, i, size = 0;
+  char *ptr;
+
+  if (isnan(value)) {
+    orc__json__write(json, "NaN", 3);
+    return;
+  }
+  if (isinf(value)) {
+    orc__json__write(json, value > 0 ? "Infinity" : "-Infinity", value > 0 ? 8 : 9);
+    return;
+  }
+  if (value == 0) {
+    orc__json__write(json, signbit(value) ? "-0.0" : "0.0", signbit(value) ? 4 : 3);
+    return;
+  }
+
+  /* Decimals of up to DBL_DIG digits name distinct normal doubles, so when the DBL_DIG digit rounding round-trips
+   * the shortest form is it without its trailing zeros. Subnormals hold fewer digits and are searched from 1. */
+  for (precision = fabs(value) < DBL_MIN ? 1 : DBL_DIG; precision <= 17; ++precision) {
+    snprintf(buffer, sizeof(buffer), "%.*e", precision-1, value);
+    if (precision == 17 || strtod(buffer, NULL) == value) {
+      break;
+    }
+  }
+  for (ptr=buffer; *ptr != 'e'; ++ptr) {
+    if (*ptr >= '0' && *ptr <= '9') {
+      digits[n_digits++] = *ptr;
+    }
+  }
+  exponent = atoi(ptr+1);
+  while (n_digits > 1 && digits[n_digits-1] == '0') {
+    n_digits -= 1;
+  }
+  decpt = exponent+1;
+
+  if (value < 0) {
+    output[size++] = '-';
+  }
+  if (decpt <= -4 || decpt > 16) {
+    output[size++] = digits[0];
+    if (n_digits > 1) {
+      output[size++] = '.';
+      memcpy(output+size, digits+1, n_digits-1);
+      size += n_digits-1;
+    }
+    size += snprintf(output+size, sizeof(output)-size, "e%+.02d", exponent);
+  }
+  else if (decpt <= 0) {
+    output[size++] = '0';
+    output[size++] = '.';
+    for (i=decpt; i < 0; ++i) {
+      output[size++] = '0';
+    }
+    memcpy(output+size, digits, n_digits);
+    size += n_digits;
+  }
+  else if (decpt >= n_digits) {
+    memcpy(output+size, digits, n_digits);
+    size += n_digits;
+    for (i=n_digits; i < decpt; ++i) {
+      output[size++] = '0';
+    }
+    output[size++] = '.';
+    output[size++] = '0';
+  }
+  else {
+    memcpy(output+size, digits, decpt);
+    size += decpt;
+    output[size++] = '.';
+    memcpy(output+size, digits+decpt, n_digits-decpt);
+    size += n_digits-decpt;
+  }
+  orc__json__write(json, output, size);
+}
+
+void orc__json__bool(orc__json_t *json, int value) {
+  orc__json__write(json, value ? "true" : "false", value ? 4 : 5);
+}
+
+void orc__json__null(orc__json_t *json) {
+  orc__json__write(json, "null", 4);
+}
+
+void orc__json__escape(orc__json_t *json, uint32_t code_point) {
+  static const char hex[] = "0123456789abcdef";
+  char output[6] = {'\\', 'u', hex[(code_point >> 12) & 15], hex[(code_point >> 8) & 15],
+                    hex[(code_point >> 4) & 15], hex[code_point & 15]};
+  orc__json__write(json, output, 6);
+}
+
+/* Length of the UTF-8 sequence at value and its code point, 0 if it is not valid UTF-8 */
+size_t orc__json__utf8(const uint8_t *value, const uint8_t *end, uint32_t *code_point) {
+  uint8_t lower = 0x80, upper = 0xBF;
+  size_t n, length;
+  if (value[0] >= 0xC2 && value[0] <= 0xDF) {
+    length = 2;
+    *code_point = value[0] & 0x1F;
+  }
+  else if (value[0] >= 0xE0 && value[0] <= 0xEF) {
+    length = 3;
+    *code_point = value[0] & 0x0F;
+    lower = value[0] == 0xE0 ? 0xA0 : 0x80;
+    upper = value[0] == 0xED ? 0x9F : 0xBF;
+  }
+  else if (value[0] >= 0xF0 && value[0] <= 0xF4) {
+    length = 4;
+    *code_point = value[0] & 0x07;
+    lower = value[0] == 0xF0 ? 0x90 : 0x80;
+    upper = value[0] == 0xF4 ? 0x8F : 0xBF;
+  }
+  else {
+    return 0;
+  }
+  if ((size_t) (end-value) < length || value[1] < lower || value[1] > upper) {
+    return 0;
+  }
+  for (n=1; n < length; ++n) {
+    if (n > 1 && (value[n] < 0x80 || value[n] > 0xBF)) {
+      return 0;
+    }
+    *code_point = (*code_point << 6) | (value[n] & 0x3F);
+  }
+  return length;
+}
+
+/* String escaped to ASCII like json.dumps does by default. Bytes which are not valid UTF-8 are written as the
+ * lone surrogates Python 3 decodes them to. */
+void orc__json__string(orc__json_t *json, const char *value, size_t length) {
+  const uint8_t *ptr = (const uint8_t *) value, *end = ptr+length, *run;
+  uint32_t code_point;
+  size_t size;
+
+  orc__json__write(json, "\"", 1);
+  while (ptr < end) {
+    for (run=ptr; ptr < end && *ptr >= ' ' && *ptr <= '~' && *ptr != '"' && *ptr != '\\'; ++ptr);
+    orc__json__write(json, (const char *) run, ptr-run);
+    if (ptr == end) {
+      break;
+    }
+
+    if (*ptr >= 0x80) {
+      if ((size = orc__json__utf8(ptr, end, &code_point)) == 0) {
+        orc__json__escape(json, 0xDC00 | *ptr++);
+        continue;
+      }
+      if (code_point >= 0x10000) {
+        orc__json__escape(json, 0xD800 | ((code_point-0x10000) >> 10));
+        orc__json__escape(json, 0xDC00 | ((code_point-0x10000) & 0x3FF));
+      }
+      else {
+        orc__json__escape(json, code_point);
+      }
+      ptr += size;
+      continue;
+    }
+
+    switch (*ptr) {
+      case '"':  orc__json__write(json, "\\\"", 2); break;
+      case '\\': orc__json__write(json, "\\\\", 2); break;
+      case '\b': orc__json__write(json, "\\b", 2); break;
+      case '\f': orc__json__write(json, "\\f", 2); break;
+      case '\n': orc__json__write(json, "\\n", 2); break;
+      case '\r': orc__json__write(json, "\\r", 2); break;
+      case '\t': orc__json__write(json, "\\t", 2); break;
+      default:   orc__json__escape(json, *ptr); break;
+    }
+    ptr += 1;
+  }
+  orc__json__write(json, "\"", 1);
+}
+
+/* String of the footer or metadata, which may be a view without a NUL terminator. null for a missing one. */
+void orc__json__view(orc__json_t *json, orc__reader_t *reader, const char *value) {
+  if (value == NULL) {
+    orc__json__null(json);
+    return;
+  }
+  orc__json__string(json, value, orc__reader__string_length(reader, value));
+}
+
+/* Name of an enum value from one of the tables of core.h, null for values it has none for */
+void orc__json__enum_name(orc__json_t *json, const char **names, size_t count, uint32_t value) {
+  if (value >= count || names[value] == NULL) {
+    orc__json__null(json);
+    return;
+  }
+  orc__json__string(json, names[value], strlen(names[value]));
+}
+
+
+/* Statistics of columns as read_metadata builds them, integers at their full 64-bit width */
+void orc__json__column_statistics(orc__json_t *json, orc__reader_t *reader, Orc__Proto__ColumnStatistics **statistics,
+                                  size_t n) {
+  Orc__Proto__IntegerStatistics *ints;
+  Orc__Proto__DoubleStatistics *doubles;
+  Orc__Proto__StringStatistics *strings;
+  Orc__Proto__DecimalStatistics *decimals;
+  Orc__Proto__DateStatistics *dates;
+  unsigned present;
+  uint8_t *order;
+  size_t i, k;
+
+  orc__json__begin(json, '[');
+  for (i=0; i < n; ++i) {
+    if (statistics[i] == NULL) {
+      continue;
+    }
+    ints = statistics[i]->intstatistics;
+    doubles = ints == NULL ? statistics[i]->doublestatistics : NULL;
+    strings = ints == NULL && doubles == NULL ? statistics[i]->stringstatistics : NULL;
+    decimals = ints == NULL && doubles == NULL && strings == NULL ? statistics[i]->decimalstatistics : NULL;
+    dates = ints == NULL && doubles == NULL && strings == NULL && decimals == NULL ?
+            statistics[i]->datestatistics : NULL;
+
+    present = 1 << ORC__JSON_STATISTICS__COLUMN | 1 << ORC__JSON_STATISTICS__HAS_NULL |
+              1 << ORC__JSON_STATISTICS__COUNT;
+    if ((ints != NULL && ints->has_minimum) || (doubles != NULL && doubles->has_minimum) || strings != NULL ||
+        decimals != NULL || (dates != NULL && dates->has_minimum)) {
+      present |= 1 << ORC__JSON_STATISTICS__MIN;
+    }
+    if ((ints != NULL && ints->has_maximum) || (doubles != NULL && doubles->has_maximum) || strings != NULL ||
+        decimals != NULL || (dates != NULL && dates->has_maximum)) {
+      present |= 1 << ORC__JSON_STATISTICS__MAX;
+    }
+    if ((ints != NULL && ints->has_sum) || (doubles != NULL && doubles->has_sum) ||
+        (strings != NULL && strings->has_sum) || decimals != NULL) {
+      present |= 1 << ORC__JSON_STATISTICS__SUM;
+    }
+
+    orc__json__item(json);
+    orc__json__begin(json, '{');
+    order = orc__json_statistics.orders[present];
+    for (k=0; k < ORC__JSON_MAX_KEYS && order[k] != ORC__JSON_NO_KEY; ++k) {
+      orc__json__key(json, orc__json_statistics.keys[order[k]]);
+      switch (order[k]) {
+        case ORC__JSON_STATISTICS__COLUMN:
+          orc__json__uint(json, i);
+          break;
+        case ORC__JSON_STATISTICS__HAS_NULL:
+          orc__json__bool(json, statistics[i]->hasnull);
+          break;
+        case ORC__JSON_STATISTICS__COUNT:
+          orc__json__uint(json, statistics[i]->numberofvalues);
+          break;
+        case ORC__JSON_STATISTICS__MIN:
+          if (ints != NULL) orc__json__int(json, ints->minimum);
+          if (doubles != NULL) orc__json__double(json, doubles->minimum);
+          if (strings != NULL) orc__json__view(json, reader, strings->minimum);
+          if (decimals != NULL) orc__json__view(json, reader, decimals->minimum);
+          if (dates != NULL) orc__json__int(json, dates->minimum);
+          break;
+        case ORC__JSON_STATISTICS__MAX:
+          if (ints != NULL) orc__json__int(json, ints->maximum);
+          if (doubles != NULL) orc__json__double(json, doubles->maximum);
+          if (strings != NULL) orc__json__view(json, reader, strings->maximum);
+          if (decimals != NULL) orc__json__view(json, reader, decimals->maximum);
+          if (dates != NULL) orc__json__int(json, dates->maximum);
+          break;
+        case ORC__JSON_STATISTICS__SUM:
+          if (ints != NULL) orc__json__int(json, ints->sum);
+          if (doubles != NULL) orc__json__double(json, doubles->sum);
+          if (strings != NULL) orc__json__int(json, strings->sum);
+          if (decimals != NULL) orc__json__view(json, reader, decimals->sum);
+          break;
+      }
+    }
+    orc__json__end(json, '}');
+  }
+  orc__json__end(json, ']');
+}
+
+/* Statistics of stripe i, which must have been decoded */
+void orc__json__stripe_statistics(orc__json_t *json, orc__reader_t *reader, size_t i) {
+  uint8_t *order = orc__json_stripe_statistics.orders[3];
+  size_t k;
+  orc__json__begin(json, '{');
+  for (k=0; k < orc__json_stripe_statistics.n_keys; ++k) {
+    orc__json__key(json, orc__json_stripe_statistics.keys[order[k]]);
+    if (order[k] == ORC__JSON_STRIPE_STATISTICS__STRIPE) {
+      orc__json__uint(json, i);
+    }
+    else {
+      orc__json__column_statistics(json, reader, reader->metadata->stripestats[i]->colstats,
+                                   reader->metadata->stripestats[i]->n_colstats);
+    }
+  }
+  orc__json__end(json, '}');
+}
+
+void orc__json__streams(orc__json_t *json, Orc__Proto__StripeInformation *stripe, Orc__Proto__StripeFooter *footer) {
+  uint8_t *order = orc__json_stream.orders[15];
+  int64_t offset = stripe->offset;
+  size_t j, k;
+  orc__json__begin(json, '[');
+  for (j=0; j < footer->n_streams; ++j) {
+    orc__json__item(json);
+    orc__json__begin(json, '{');
+    for (k=0; k < orc__json_stream.n_keys; ++k) {
+      orc__json__key(json, orc__json_stream.keys[order[k]]);
+      switch (order[k]) {
+        case ORC__JSON_STREAM__SECTION:
+          orc__json__enum_name(json, orc__stream_kind_names, ORC__STREAM_KINDS, footer->streams[j]->kind);
+          break;
+        case ORC__JSON_STREAM__COLUMN:
+          orc__json__uint(json, footer->streams[j]->column);
+          break;
+        case ORC__JSON_STREAM__START:
+          orc__json__int(json, offset);
+          break;
+        case ORC__JSON_STREAM__LENGTH:
+          orc__json__uint(json, footer->streams[j]->length);
+          break;
+      }
+    }
+    orc__json__end(json, '}');
+    offset += footer->streams[j]->length;
+  }
+  orc__json__end(json, ']');
+}
+
+void orc__json__encodings(orc__json_t *json, Orc__Proto__StripeFooter *footer) {
+  uint8_t *order = orc__json_encoding.orders[3];
+  char name[32];
+  size_t j, k;
+  orc__json__begin(json, '[');
+  for (j=0; j < footer->n_columns; ++j) {
+    orc__json__item(json);
+    orc__json__begin(json, '{');
+    for (k=0; k < orc__json_encoding.n_keys; ++k) {
+      orc__json__key(json, orc__json_encoding.keys[order[k]]);
+      if (order[k] == ORC__JSON_ENCODING__COLUMN) {
+        orc__json__uint(json, j);
+      }
+      else if (footer->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DICTIONARY ||
+               footer->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DICTIONARY_V2) {
+        orc__json__string(json, name, snprintf(name, sizeof(name), "%s[%u]",
+                          footer->columns[j]->kind == ORC__COLUMN_ENCODING_KIND__DICTIONARY ? "DICTIONARY" :
+                          "DICTIONARY_V2", (unsigned) footer->columns[j]->dictionarysize));
+      }
+      else {
+        orc__json__enum_name(json, orc__encoding_names, ORC__ENCODING_KINDS, footer->columns[j]->kind);
+      }
+    }
+    orc__json__end(json, '}');
+  }
+  orc__json__end(json, ']');
+}
+
+/* Stripe i along with its footer, which must have been decoded */
+void orc__json__stripe(orc__json_t *json, orc__reader_t *reader, size_t i) {
+  Orc__Proto__StripeInformation *stripe = reader->footer->stripes[i];
+  uint8_t *order = orc__json_stripe.orders[255];
+  size_t k;
+  orc__json__begin(json, '{');
+  for (k=0; k < orc__json_stripe.n_keys; ++k) {
+    orc__json__key(json, orc__json_stripe.keys[order[k]]);
+    switch (order[k]) {
+      case ORC__JSON_STRIPE__STRIPE:    orc__json__uint(json, i); break;
+      case ORC__JSON_STRIPE__OFFSET:    orc__json__uint(json, stripe->offset); break;
+      case ORC__JSON_STRIPE__DATA:      orc__json__uint(json, stripe->datalength); break;
+      case ORC__JSON_STRIPE__ROWS:      orc__json__uint(json, stripe->numberofrows); break;
+      case ORC__JSON_STRIPE__TAIL:      orc__json__uint(json, stripe->footerlength); break;
+      case ORC__JSON_STRIPE__INDEX:     orc__json__uint(json, stripe->indexlength); break;
+      case ORC__JSON_STRIPE__STREAMS:   orc__json__streams(json, stripe, reader->stripe_footers[i]); break;
+      case ORC__JSON_STRIPE__ENCODINGS: orc__json__encodings(json, reader->stripe_footers[i]); break;
+    }
+  }
+  orc__json__end(json, '}');
+}
+
+/* Version string as read_metadata builds it, null for writer versions it does not know */
+void orc__json__version(orc__json_t *json, orc__reader_t *reader) {
+  Orc__Proto__PostScript *post_script = reader->post_script;
+  char version[64];
+  if (post_script->writerversion >= ORC__WRITER_VERSIONS) {
+    orc__json__null(json);
+    return;
+  }
+  orc__json__string(json, version, snprintf(version, sizeof(version), "%i.%i with %s",
+                    post_script->n_version > 0 ? (int) post_script->version[0] : 0,
+                    post_script->n_version > 1 ? (int) post_script->version[1] : 0,
+                    orc__writer_version_names[post_script->writerversion]));
+}
+
+/* Write a decoded reader as json.dumps of Python 2 writes what read_metadata returns for it with the same
+ * options. The statistics of the stripes start+n*step for n below stripe_count must have been decoded. Fails
+ * only if the schema can not be rendered, write errors are left in json->error. */
+int orc__json__metadata(orc__json_t *json, orc__reader_t *reader, int enable_schema, int enable_file_stats,
+                        int enable_stripe_stats, int enable_stripes, ssize_t start, ssize_t step,
+                        ssize_t stripe_count) {
+  char *schema = NULL;
+  size_t schema_length = 0, i, k;
+  ssize_t n;
+  int status;
+  if (enable_schema && (status = orc__schema__build(reader, &schema, &schema_length)) != ORC__OK) {
+    return status;
+  }
+
+  unsigned present = 1 << ORC__JSON_METADATA__ROWS | 1 << ORC__JSON_METADATA__COMPRESSION |
+                     1 << ORC__JSON_METADATA__VERSION | 1 << ORC__JSON_METADATA__COMPRESSION_SIZE |
+                     (enable_schema != 0) << ORC__JSON_METADATA__SCHEMA |
+                     (enable_stripe_stats != 0) << ORC__JSON_METADATA__STRIPE_STATISTICS |
+                     (enable_file_stats != 0) << ORC__JSON_METADATA__FILE_STATISTICS |
+                     (enable_stripes != 0) << ORC__JSON_METADATA__STRIPES;
+  uint8_t *order = orc__json_metadata.orders[present];
+
+  orc__json__begin(json, '{');
+  for (k=0; k < ORC__JSON_MAX_KEYS && order[k] != ORC__JSON_NO_KEY; ++k) {
+    orc__json__key(json, orc__json_metadata.keys[order[k]]);
+    switch (order[k]) {
+      case ORC__JSON_METADATA__ROWS:
+        orc__json__uint(json, reader->footer->numberofrows);
+        break;
+      case ORC__JSON_METADATA__COMPRESSION:
+        orc__json__enum_name(json, orc__compression_names, ORC__COMPRESSION_KINDS,
+                             reader->post_script->compression);
+        break;
+      case ORC__JSON_METADATA__VERSION:
+        orc__json__version(json, reader);
+        break;
+      case ORC__JSON_METADATA__COMPRESSION_SIZE:
+        orc__json__uint(json, reader->post_script->compressionblocksize);
+        break;
+      case ORC__JSON_METADATA__SCHEMA:
+        orc__json__string(json, schema, schema_length);
+        break;
+      case ORC__JSON_METADATA__STRIPE_STATISTICS:
+        orc__json__begin(json, '[');
+        for (n=0; n < stripe_count; ++n) {
+          orc__json__item(json);
+          orc__json__stripe_statistics(json, reader, start+n*step);
+        }
+        orc__json__end(json, ']');
+        break;
+      case ORC__JSON_METADATA__FILE_STATISTICS:
+        orc__json__column_statistics(json, reader, reader->footer->statistics, reader->footer->n_statistics);
+        break;
+      case ORC__JSON_METADATA__STRIPES:
+        orc__json__begin(json, '[');
+        for (i=0; i < reader->footer->n_stripes; ++i) {
+          orc__json__item(json);
+          orc__json__stripe(json, reader, i);
+        }
+        orc__json__end(json, ']');
+        break;
+    }
+  }
+  orc__json__end(json, '}');
+  return ORC__OK;
+}
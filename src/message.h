@@ -0,0 +1,914 @@
+#pragma once
+#include <string.h>
+#include "core.h"
+#include "arena.h"
+#include "wire.h"
+
+
+/* Straight-line decoders for the messages read from every file, switching on compile time constant tags
+ * instead of going through the field descriptors. Messages are allocated in the arena. Anything the
+ * decoders do not expect, e.g. a repeated submessage which would have to be merged, makes them fail,
+ * and the orc__message__unpack_* functions fall back to the generic protobuf-c unpack. */
+
+
+/* Read the next tag, along with the value of varint and 64 bit fields */
+int orc__message__next(uint8_t **ptr, uint8_t *end, uint64_t *tag, uint64_t *value) {
+  if (orc__wire__varint(ptr, end, tag) != ORC__OK || (*tag >> 3) == 0) {
+    return ORC__NODECODE;
+  }
+  if ((*tag & 7) == ORC__WIRE_TYPE__VARINT) {
+    return orc__wire__varint(ptr, end, value);
+  }
+  if ((*tag & 7) == ORC__WIRE_TYPE__64BIT) {
+    return orc__wire__fixed64(ptr, end, value);
+  }
+  return ORC__OK;
+}
+
+/* Unknown fields are skipped, known ones with an unexpected wire type are an error */
+int orc__message__skip(uint8_t **ptr, uint8_t *end, uint64_t tag, uint32_t max_field) {
+  if ((tag >> 3) <= max_field) {
+    return ORC__NODECODE;
+  }
+  if ((tag & 7) == ORC__WIRE_TYPE__VARINT || (tag & 7) == ORC__WIRE_TYPE__64BIT) {
+    return ORC__OK;
+  }
+  return orc__wire__skip(ptr, end, tag & 7);
+}
+
+/* Copy a string field into the arena, NUL terminated like protobuf-c does. With views the string points
+ * at its bytes in the message instead, which are not terminated, see orc__wire__prefixed_length. Empty
+ * views point at a constant empty string, so that every view lies within the bytes it was decoded from. */
+int orc__message__string(orc__arena_t *arena, uint8_t **ptr, uint8_t *end, int views, char **output) {
+  uint8_t *bytes;
+  size_t length;
+  if (orc__wire__bytes(ptr, end, &bytes, &length) != ORC__OK) {
+    return ORC__NODECODE;
+  }
+  if (views) {
+    *output = length > 0 ? (char *) bytes : (char *) "";
+    return ORC__OK;
+  }
+
+  char *string;
+  if ((string = orc__arena__alloc(arena, length+1)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  memcpy(string, bytes, length);
+  string[length] = '\0';
+  *output = string;
+  return ORC__OK;
+}
+
+double orc__message__double(uint64_t value) {
+  double result;
+  memcpy(&result, &value, sizeof(result));
+  return result;
+}
+
+/* Gather the values of a repeated varint field from the whole message, whether packed or not, into
+ * an array of width byte integers. The first pass counts them, the second one stores them. */
+int orc__message__varints(orc__arena_t *arena, uint8_t *start, uint8_t *end, uint32_t field, size_t width,
+                          size_t *n, void **output) {
+  uint8_t *ptr, *packed, *packed_end;
+  uint64_t tag, value;
+  size_t length, count = 0;
+  void *values = NULL;
+  int pass;
+
+  for (pass=0; pass < 2; ++pass) {
+    ptr = start;
+    count = 0;
+    while (ptr < end) {
+      if (orc__wire__varint(&ptr, end, &tag) != ORC__OK) {
+        return ORC__NODECODE;
+      }
+      if ((tag >> 3) != field) {
+        if (orc__wire__skip(&ptr, end, tag & 7) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+        continue;
+      }
+
+      if ((tag & 7) == ORC__WIRE_TYPE__VARINT) {
+        packed = ptr;
+        if (orc__wire__varint(&ptr, end, &value) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+        packed_end = ptr;
+      }
+      else if ((tag & 7) == ORC__WIRE_TYPE__LENGTH_DELIMITED && orc__wire__bytes(&ptr, end, &packed, &length) == ORC__OK) {
+        packed_end = packed+length;
+      }
+      else {
+        return ORC__NODECODE;
+      }
+
+      while (packed < packed_end) {
+        if (orc__wire__varint(&packed, packed_end, &value) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+        if (values != NULL && width == sizeof(uint32_t)) {
+          ((uint32_t *) values)[count] = value;
+        }
+        if (values != NULL && width == sizeof(uint64_t)) {
+          ((uint64_t *) values)[count] = value;
+        }
+        count++;
+      }
+    }
+
+    if (count == 0 || values != NULL) {
+      break;
+    }
+    if ((values = orc__arena__alloc(arena, width*count)) == NULL) {
+      return ORC__ENOMEM;
+    }
+  }
+
+  *n = count;
+  *output = values;
+  return ORC__OK;
+}
+
+
+int orc__message__post_script(orc__arena_t *arena, uint8_t *ptr, uint8_t *end, Orc__Proto__PostScript **output) {
+  Orc__Proto__PostScript *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__PostScript))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__post_script__init(message);
+
+  uint8_t *start = ptr;
+  uint64_t tag, value;
+  int status;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_footerlength = 1;
+        message->footerlength = value;
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__VARINT):
+        message->has_compression = 1;
+        message->compression = (int32_t) value;
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__VARINT):
+        message->has_compressionblocksize = 1;
+        message->compressionblocksize = value;
+        break;
+      case ORC__WIRE_TAG(4, ORC__WIRE_TYPE__VARINT):
+      case ORC__WIRE_TAG(4, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->version == NULL) {
+          if ((status = orc__message__varints(arena, start, end, 4, sizeof(uint32_t), &message->n_version,
+                                              (void **) &message->version)) != ORC__OK) {
+            return status;
+          }
+        }
+        if ((tag & 7) == ORC__WIRE_TYPE__LENGTH_DELIMITED && orc__wire__skip(&ptr, end, tag & 7) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+        break;
+      case ORC__WIRE_TAG(5, ORC__WIRE_TYPE__VARINT):
+        message->has_metadatalength = 1;
+        message->metadatalength = value;
+        break;
+      case ORC__WIRE_TAG(6, ORC__WIRE_TYPE__VARINT):
+        message->has_writerversion = 1;
+        message->writerversion = value;
+        break;
+      case ORC__WIRE_TAG(8000, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if ((status = orc__message__string(arena, &ptr, end, 0, &message->magic)) != ORC__OK) {
+          return status;
+        }
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 6) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__stripe_information(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                     Orc__Proto__StripeInformation **output) {
+  Orc__Proto__StripeInformation *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__StripeInformation))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__stripe_information__init(message);
+
+  uint64_t tag, value;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_offset = 1;
+        message->offset = value;
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__VARINT):
+        message->has_indexlength = 1;
+        message->indexlength = value;
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__VARINT):
+        message->has_datalength = 1;
+        message->datalength = value;
+        break;
+      case ORC__WIRE_TAG(4, ORC__WIRE_TYPE__VARINT):
+        message->has_footerlength = 1;
+        message->footerlength = value;
+        break;
+      case ORC__WIRE_TAG(5, ORC__WIRE_TYPE__VARINT):
+        message->has_numberofrows = 1;
+        message->numberofrows = value;
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 5) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__type(orc__arena_t *arena, uint8_t *ptr, uint8_t *end, int views, Orc__Proto__Type **output) {
+  Orc__Proto__Type *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__Type))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__type__init(message);
+
+  uint8_t *start = ptr;
+  uint64_t tag, value;
+  size_t count;
+  int status;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_kind = 1;
+        message->kind = (int32_t) value;
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__VARINT):
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->subtypes == NULL) {
+          if ((status = orc__message__varints(arena, start, end, 2, sizeof(uint32_t), &message->n_subtypes,
+                                              (void **) &message->subtypes)) != ORC__OK) {
+            return status;
+          }
+        }
+        if ((tag & 7) == ORC__WIRE_TYPE__LENGTH_DELIMITED && orc__wire__skip(&ptr, end, tag & 7) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->fieldnames == NULL) {
+          if (orc__wire__count(start, end, 3, &count) != ORC__OK) {
+            return ORC__NODECODE;
+          }
+          if ((message->fieldnames = orc__arena__alloc(arena, sizeof(char *)*count)) == NULL) {
+            return ORC__ENOMEM;
+          }
+        }
+        if ((status = orc__message__string(arena, &ptr, end, views,
+                                           &message->fieldnames[message->n_fieldnames++])) != ORC__OK) {
+          return status;
+        }
+        break;
+      case ORC__WIRE_TAG(4, ORC__WIRE_TYPE__VARINT):
+        message->has_maximumlength = 1;
+        message->maximumlength = value;
+        break;
+      case ORC__WIRE_TAG(5, ORC__WIRE_TYPE__VARINT):
+        message->has_precision = 1;
+        message->precision = value;
+        break;
+      case ORC__WIRE_TAG(6, ORC__WIRE_TYPE__VARINT):
+        message->has_scale = 1;
+        message->scale = value;
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 6) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+
+int orc__message__integer_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                     Orc__Proto__IntegerStatistics **output) {
+  Orc__Proto__IntegerStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__IntegerStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__integer_statistics__init(message);
+
+  uint64_t tag, value;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_minimum = 1;
+        message->minimum = orc__wire__zigzag64(value);
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__VARINT):
+        message->has_maximum = 1;
+        message->maximum = orc__wire__zigzag64(value);
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__VARINT):
+        message->has_sum = 1;
+        message->sum = orc__wire__zigzag64(value);
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 3) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__double_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                    Orc__Proto__DoubleStatistics **output) {
+  Orc__Proto__DoubleStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__DoubleStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__double_statistics__init(message);
+
+  uint64_t tag, value;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__64BIT):
+        message->has_minimum = 1;
+        message->minimum = orc__message__double(value);
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__64BIT):
+        message->has_maximum = 1;
+        message->maximum = orc__message__double(value);
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__64BIT):
+        message->has_sum = 1;
+        message->sum = orc__message__double(value);
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 3) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__string_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end, int views,
+                                    Orc__Proto__StringStatistics **output) {
+  Orc__Proto__StringStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__StringStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__string_statistics__init(message);
+
+  uint64_t tag, value;
+  int status;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if ((status = orc__message__string(arena, &ptr, end, views, &message->minimum)) != ORC__OK) {
+          return status;
+        }
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if ((status = orc__message__string(arena, &ptr, end, views, &message->maximum)) != ORC__OK) {
+          return status;
+        }
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__VARINT):
+        message->has_sum = 1;
+        message->sum = orc__wire__zigzag64(value);
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 3) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__bucket_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                    Orc__Proto__BucketStatistics **output) {
+  Orc__Proto__BucketStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__BucketStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__bucket_statistics__init(message);
+
+  /* The only field is the repeated count, gathered in one go */
+  int status;
+  if ((status = orc__message__varints(arena, ptr, end, 1, sizeof(uint64_t), &message->n_count,
+                                      (void **) &message->count)) != ORC__OK) {
+    return status;
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__decimal_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end, int views,
+                                     Orc__Proto__DecimalStatistics **output) {
+  Orc__Proto__DecimalStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__DecimalStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__decimal_statistics__init(message);
+
+  uint64_t tag, value;
+  int status;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if ((status = orc__message__string(arena, &ptr, end, views, &message->minimum)) != ORC__OK) {
+          return status;
+        }
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if ((status = orc__message__string(arena, &ptr, end, views, &message->maximum)) != ORC__OK) {
+          return status;
+        }
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if ((status = orc__message__string(arena, &ptr, end, views, &message->sum)) != ORC__OK) {
+          return status;
+        }
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 3) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__date_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                  Orc__Proto__DateStatistics **output) {
+  Orc__Proto__DateStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__DateStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__date_statistics__init(message);
+
+  uint64_t tag, value;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_minimum = 1;
+        message->minimum = orc__wire__zigzag32(value);
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__VARINT):
+        message->has_maximum = 1;
+        message->maximum = orc__wire__zigzag32(value);
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 2) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__binary_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                    Orc__Proto__BinaryStatistics **output) {
+  Orc__Proto__BinaryStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__BinaryStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__binary_statistics__init(message);
+
+  uint64_t tag, value;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_sum = 1;
+        message->sum = orc__wire__zigzag64(value);
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 1) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__timestamp_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                       Orc__Proto__TimestampStatistics **output) {
+  Orc__Proto__TimestampStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__TimestampStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__timestamp_statistics__init(message);
+
+  uint64_t tag, value;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_minimum = 1;
+        message->minimum = orc__wire__zigzag64(value);
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__VARINT):
+        message->has_maximum = 1;
+        message->maximum = orc__wire__zigzag64(value);
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__VARINT):
+        message->has_minimumutc = 1;
+        message->minimumutc = orc__wire__zigzag64(value);
+        break;
+      case ORC__WIRE_TAG(4, ORC__WIRE_TYPE__VARINT):
+        message->has_maximumutc = 1;
+        message->maximumutc = orc__wire__zigzag64(value);
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 4) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__column_statistics(orc__arena_t *arena, uint8_t *ptr, uint8_t *end, int views,
+                                    Orc__Proto__ColumnStatistics **output) {
+  Orc__Proto__ColumnStatistics *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__ColumnStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__column_statistics__init(message);
+
+  uint8_t *bytes = NULL;
+  size_t length = 0;
+  uint64_t tag, value;
+  int status = ORC__OK;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+
+    /* Typed statistics are submessages, a repeated one would have to be merged */
+    if ((tag & 7) == ORC__WIRE_TYPE__LENGTH_DELIMITED && (tag >> 3) >= 2 && (tag >> 3) <= 9) {
+      if (orc__wire__bytes(&ptr, end, &bytes, &length) != ORC__OK) {
+        return ORC__NODECODE;
+      }
+    }
+
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_numberofvalues = 1;
+        message->numberofvalues = value;
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->intstatistics != NULL) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__integer_statistics(arena, bytes, bytes+length, &message->intstatistics);
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->doublestatistics != NULL) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__double_statistics(arena, bytes, bytes+length, &message->doublestatistics);
+        break;
+      case ORC__WIRE_TAG(4, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->stringstatistics != NULL) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__string_statistics(arena, bytes, bytes+length, views, &message->stringstatistics);
+        break;
+      case ORC__WIRE_TAG(5, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->bucketstatistics != NULL) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__bucket_statistics(arena, bytes, bytes+length, &message->bucketstatistics);
+        break;
+      case ORC__WIRE_TAG(6, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->decimalstatistics != NULL) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__decimal_statistics(arena, bytes, bytes+length, views,
+                                                  &message->decimalstatistics);
+        break;
+      case ORC__WIRE_TAG(7, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->datestatistics != NULL) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__date_statistics(arena, bytes, bytes+length, &message->datestatistics);
+        break;
+      case ORC__WIRE_TAG(8, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->binarystatistics != NULL) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__binary_statistics(arena, bytes, bytes+length, &message->binarystatistics);
+        break;
+      case ORC__WIRE_TAG(9, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (message->timestampstatistics != NULL) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__timestamp_statistics(arena, bytes, bytes+length, &message->timestampstatistics);
+        break;
+      case ORC__WIRE_TAG(10, ORC__WIRE_TYPE__VARINT):
+        message->has_hasnull = 1;
+        message->hasnull = value != 0;
+        break;
+      default:
+        status = orc__message__skip(&ptr, end, tag, 10);
+    }
+    if (status != ORC__OK) {
+      return status;
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__user_metadata_item(orc__arena_t *arena, uint8_t *ptr, uint8_t *end, int views,
+                                     Orc__Proto__UserMetadataItem **output) {
+  Orc__Proto__UserMetadataItem *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__UserMetadataItem))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__user_metadata_item__init(message);
+
+  uint8_t *bytes;
+  size_t length;
+  uint64_t tag, value;
+  int status = ORC__OK;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        status = orc__message__string(arena, &ptr, end, views, &message->name);
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (orc__wire__bytes(&ptr, end, &bytes, &length) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+        /* Bytes fields carry their length, so a view needs no special handling */
+        message->has_value = 1;
+        message->value.len = length;
+        message->value.data = bytes;
+        if (!views && length > 0) {
+          if ((message->value.data = orc__arena__alloc(arena, length)) == NULL) {
+            return ORC__ENOMEM;
+          }
+          memcpy(message->value.data, bytes, length);
+        }
+        break;
+      default:
+        status = orc__message__skip(&ptr, end, tag, 2);
+    }
+    if (status != ORC__OK) {
+      return status;
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+
+int orc__message__stream(orc__arena_t *arena, uint8_t *ptr, uint8_t *end, Orc__Proto__Stream **output) {
+  Orc__Proto__Stream *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__Stream))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__stream__init(message);
+
+  uint64_t tag, value;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_kind = 1;
+        message->kind = (int32_t) value;
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__VARINT):
+        message->has_column = 1;
+        message->column = value;
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__VARINT):
+        message->has_length = 1;
+        message->length = value;
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 3) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__column_encoding(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                  Orc__Proto__ColumnEncoding **output) {
+  Orc__Proto__ColumnEncoding *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__ColumnEncoding))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__column_encoding__init(message);
+
+  uint64_t tag, value;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__VARINT):
+        message->has_kind = 1;
+        message->kind = (int32_t) value;
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__VARINT):
+        message->has_dictionarysize = 1;
+        message->dictionarysize = value;
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__VARINT):
+        message->has_bloomencoding = 1;
+        message->bloomencoding = value;
+        break;
+      default:
+        if (orc__message__skip(&ptr, end, tag, 3) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+int orc__message__stripe_footer(orc__arena_t *arena, uint8_t *ptr, uint8_t *end,
+                                Orc__Proto__StripeFooter **output) {
+  Orc__Proto__StripeFooter *message;
+  if ((message = orc__arena__alloc(arena, sizeof(Orc__Proto__StripeFooter))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__stripe_footer__init(message);
+
+  size_t n_streams, n_columns;
+  if (orc__wire__count(ptr, end, 1, &n_streams) != ORC__OK || orc__wire__count(ptr, end, 2, &n_columns) != ORC__OK) {
+    return ORC__NODECODE;
+  }
+  if ((n_streams > 0 && (message->streams = orc__arena__alloc(arena, sizeof(void *)*n_streams)) == NULL) ||
+      (n_columns > 0 && (message->columns = orc__arena__alloc(arena, sizeof(void *)*n_columns)) == NULL)) {
+    return ORC__ENOMEM;
+  }
+
+  uint8_t *bytes;
+  size_t length;
+  uint64_t tag, value;
+  int status;
+  while (ptr < end) {
+    if (orc__message__next(&ptr, end, &tag, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    switch (tag) {
+      case ORC__WIRE_TAG(1, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (orc__wire__bytes(&ptr, end, &bytes, &length) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__stream(arena, bytes, bytes+length, &message->streams[message->n_streams++]);
+        break;
+      case ORC__WIRE_TAG(2, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        if (orc__wire__bytes(&ptr, end, &bytes, &length) != ORC__OK) {
+          return ORC__NODECODE;
+        }
+        status = orc__message__column_encoding(arena, bytes, bytes+length, &message->columns[message->n_columns++]);
+        break;
+      case ORC__WIRE_TAG(3, ORC__WIRE_TYPE__LENGTH_DELIMITED):
+        status = orc__message__string(arena, &ptr, end, 0, &message->writertimezone);
+        break;
+      default:
+        status = orc__message__skip(&ptr, end, tag, 3);
+    }
+    if (status != ORC__OK) {
+      return status;
+    }
+  }
+
+  *output = message;
+  return ORC__OK;
+}
+
+
+/* Decode with the straight-line decoders, falling back to the generic protobuf-c unpack when they fail,
+ * or always using it when generic is set. NULL when neither could decode the message. With views, strings
+ * decoded by the straight-line decoders point into data, which must then outlive the message. */
+Orc__Proto__PostScript *orc__message__unpack_post_script(orc__arena_t *arena, uint8_t *data, size_t size,
+                                                         int generic) {
+  Orc__Proto__PostScript *message;
+  if (generic || orc__message__post_script(arena, data, data+size, &message) != ORC__OK) {
+    message = orc__proto__post_script__unpack(&arena->allocator, size, data);
+  }
+  return message;
+}
+
+Orc__Proto__StripeInformation *orc__message__unpack_stripe_information(orc__arena_t *arena, uint8_t *data,
+                                                                       size_t size, int generic) {
+  Orc__Proto__StripeInformation *message;
+  if (generic || orc__message__stripe_information(arena, data, data+size, &message) != ORC__OK) {
+    message = orc__proto__stripe_information__unpack(&arena->allocator, size, data);
+  }
+  return message;
+}
+
+Orc__Proto__Type *orc__message__unpack_type(orc__arena_t *arena, uint8_t *data, size_t size, int generic,
+                                            int views) {
+  Orc__Proto__Type *message;
+  if (generic || orc__message__type(arena, data, data+size, views, &message) != ORC__OK) {
+    message = orc__proto__type__unpack(&arena->allocator, size, data);
+  }
+  return message;
+}
+
+Orc__Proto__ColumnStatistics *orc__message__unpack_column_statistics(orc__arena_t *arena, uint8_t *data,
+                                                                     size_t size, int generic, int views) {
+  Orc__Proto__ColumnStatistics *message;
+  if (generic || orc__message__column_statistics(arena, data, data+size, views, &message) != ORC__OK) {
+    message = orc__proto__column_statistics__unpack(&arena->allocator, size, data);
+  }
+  return message;
+}
+
+Orc__Proto__UserMetadataItem *orc__message__unpack_user_metadata_item(orc__arena_t *arena, uint8_t *data,
+                                                                      size_t size, int generic, int views) {
+  Orc__Proto__UserMetadataItem *message;
+  if (generic || orc__message__user_metadata_item(arena, data, data+size, views, &message) != ORC__OK) {
+    message = orc__proto__user_metadata_item__unpack(&arena->allocator, size, data);
+  }
+  return message;
+}
+
+Orc__Proto__StripeFooter *orc__message__unpack_stripe_footer(orc__arena_t *arena, uint8_t *data, size_t size,
+                                                             int generic) {
+  Orc__Proto__StripeFooter *message;
+  if (generic || orc__message__stripe_footer(arena, data, data+size, &message) != ORC__OK) {
+    message = orc__proto__stripe_footer__unpack(&arena->allocator, size, data);
+  }
+  return message;
+}
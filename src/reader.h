@@ -1,222 +1,948 @@
+#pragma once
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "core.h"
 #include "orc.pb-c.h"
+#include "arena.h"
 #include "decompressor.h"
 #include "buffer.h"
+#include "wire.h"
+#include "message.h"
+
+
+/* Speculative amount of trailing bytes read in one go, usually enough to cover 
+ * the postscript, footer and metadata sections of the file. */
+#define ORC__READER_TAIL_SIZE  16384
+
+#define ORC__READER_MODE_PREAD  0
+#define ORC__READER_MODE_MMAP   1
+#define ORC__READER_MODE_BUFFER 2
+
+/* Repeated message fields of the footer, which are only unpacked when requested */
+#define ORC__FOOTER_FIELD__STRIPES     3
+#define ORC__FOOTER_FIELD__TYPES       4
+#define ORC__FOOTER_FIELD__METADATA    5
+#define ORC__FOOTER_FIELD__STATISTICS  7
+#define ORC__FOOTER_FIELDS             8
+
+
+/* Bytes of the decompressed footer spanning every occurrence of a repeated field */
+typedef struct orc__field_range_t {
+  uint8_t *start;
+  uint8_t *end;
+  size_t count;
+  int decoded;
+} orc__field_range_t;
 
 
 typedef struct orc__reader_t {
+  /* Holds the reader, the tail and scratch buffers and every decoded message */
+  orc__arena_t *arena;
+
+  /* Holds the decompressed stripe footer being unpacked, reset after each one */
+  orc__arena_t *stripe_arena;
+
   const char *input_path;
+  int fd;
+  int mode;
+
+  /* Size of the whole file, data holds only its trailing data_size bytes,
+   * or the whole file in mmap and buffer modes */
   size_t size;
   uint8_t *data;
+  size_t data_size;
+
+  /* Scratch space for byte ranges outside of the tail, e.g. stripe footers */
+  uint8_t *scratch;
+  size_t scratch_size;
+
+  int enable_schema;
+  int enable_file_stats;
   int enable_stripes;
   int enable_stripe_stats;
 
+  /* Threads the chunks of large footer and metadata sections are decompressed on */
+  int decompress_threads;
+
+  /* Unpack every message with the descriptor driven protobuf-c decoder instead of the orc__message__ ones */
+  int generic_unpack;
+
+  /* Decode the strings of the footer and metadata as views into their decompressed sections instead of
+   * copies, read them with orc__reader__string_length. Views are not NUL terminated and are valid only while
+   * string_views is set and both sections are alive, which is until the reader is freed. Messages decoded
+   * with it cleared or which fell back to protobuf-c hold NUL terminated copies. */
+  int string_views;
+
   int post_script_decoded;
   int footer_decoded;
   int metadata_decoded;
   int stripes_decoded;
 
+  uint64_t post_script_length;
   Orc__Proto__PostScript *post_script; 
   Orc__Proto__Footer *footer;
   Orc__Proto__Metadata *metadata;
   Orc__Proto__StripeFooter **stripe_footers;
+
+  /* Indexed by field number */
+  orc__field_range_t footer_fields[ORC__FOOTER_FIELDS];
+
+  /* Decompressed footer and metadata sections, which string views point into */
+  orc__span_t footer_section;
+  orc__span_t metadata_section;
+
+  /* Bytes of each StripeStatistics in the decompressed metadata section */
+  orc__span_t *stripe_stats;
+
+  /* Sorted indexes of the columns whose statistics are decoded, all of them when NULL */
+  uint64_t *columns;
+  size_t n_columns;
 } orc__reader_t;
 
-int orc__reader__file_to_buffer(orc__reader_t *reader);
+int orc__reader__read_tail(orc__reader_t *reader, size_t tail_size);
+int orc__reader__fetch(orc__reader_t *reader, uint64_t offset, uint64_t length, uint8_t **output);
 
 
-orc__reader_t *orc__reader__init(const char *input_path, int enable_stripe_stats, int enable_stripes) {
-  orc__reader_t *reader = malloc(sizeof(orc__reader_t));
+orc__reader_t *orc__reader__alloc(int enable_stripe_stats, int enable_stripes, int mode) {
+  orc__arena_t *arena;
+  if ((arena = orc__arena__init()) == NULL) {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  orc__reader_t *reader;
+  if ((reader = orc__arena__alloc(arena, sizeof(orc__reader_t))) == NULL) {
+    orc__arena__free(arena);
+    errno = ENOMEM;
+    return NULL;
+  }
+  reader->arena = arena;
+  reader->stripe_arena = NULL;
+  reader->enable_schema = 0;
+  reader->enable_file_stats = 0;
   reader->enable_stripe_stats = enable_stripe_stats;
   reader->enable_stripes = enable_stripes;
+  reader->decompress_threads = 1;
+  reader->generic_unpack = 0;
+  reader->string_views = 0;
   reader->post_script_decoded = 0;
   reader->footer_decoded = 0;
   reader->metadata_decoded = 0;
   reader->stripes_decoded = 0;
+  reader->post_script_length = 0;
+  reader->input_path = NULL;
+  reader->fd = -1;
+  reader->mode = mode;
+  reader->size = 0;
+  reader->data = NULL;
+  reader->data_size = 0;
+  reader->scratch = NULL;
+  reader->scratch_size = 0;
+  reader->post_script = NULL;
+  reader->footer = NULL;
+  reader->metadata = NULL;
+  reader->stripe_footers = NULL;
+  memset(reader->footer_fields, 0, sizeof(reader->footer_fields));
+  memset(&reader->footer_section, 0, sizeof(orc__span_t));
+  memset(&reader->metadata_section, 0, sizeof(orc__span_t));
+  reader->stripe_stats = NULL;
+  reader->columns = NULL;
+  reader->n_columns = 0;
+  return reader;
+}
+
+/* Release a reader which failed to initialise, keeping the errno of the failure */
+void orc__reader__close(orc__reader_t *reader) {
+  int err = errno;
+  if (reader->fd >= 0) {
+    close(reader->fd);
+  }
+  orc__arena__free(reader->arena);
+  errno = err;
+}
+
+orc__reader_t *orc__reader__open(const char *input_path, int enable_stripe_stats, int enable_stripes, int mode) {
+  orc__reader_t *reader;
+  if ((reader = orc__reader__alloc(enable_stripe_stats, enable_stripes, mode)) == NULL) {
+    return NULL;
+  }
   reader->input_path = input_path;
-  orc__reader__file_to_buffer(reader);
+
+  if ((reader->fd = open(input_path, O_RDONLY)) < 0) {
+    orc__reader__close(reader);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(reader->fd, &st) != 0) {
+    orc__reader__close(reader);
+    return NULL;
+  }
+  reader->size = st.st_size;
   return reader;
 }
 
-int orc__reader__decode(orc__reader_t *reader) {
-  orc__buffer_t *post_script_buffer = orc__buffer__init_from_stream((uint8_t *) reader->data);
+
+orc__reader_t *orc__reader__init(const char *input_path, int enable_stripe_stats, int enable_stripes) {
+  orc__reader_t *reader;
+  if ((reader = orc__reader__open(input_path, enable_stripe_stats, enable_stripes, ORC__READER_MODE_PREAD)) == NULL) {
+    return NULL;
+  }
+
+  /* Speculatively read the tail of the file, the exact size is only known after the postscript is decoded */
+  size_t tail_size = reader->size < ORC__READER_TAIL_SIZE ? reader->size : ORC__READER_TAIL_SIZE;
+  if (orc__reader__read_tail(reader, tail_size) != ORC__OK) {
+    orc__reader__close(reader);
+    return NULL;
+  }
+  return reader;
+}
+
+orc__reader_t *orc__reader__init_mmap(const char *input_path, int enable_stripe_stats, int enable_stripes) {
+  orc__reader_t *reader;
+  if ((reader = orc__reader__open(input_path, enable_stripe_stats, enable_stripes, ORC__READER_MODE_MMAP)) == NULL) {
+    return NULL;
+  }
+
+  /* Empty files can not be mapped, decoding reports them as partial */
+  if (reader->size == 0) {
+    return reader;
+  }
+
+  void *mapping;
+  if ((mapping = mmap(NULL, reader->size, PROT_READ, MAP_SHARED, reader->fd, 0)) == MAP_FAILED) {
+    orc__reader__close(reader);
+    return NULL;
+  }
+  reader->data = mapping;
+  reader->data_size = reader->size;
+
+  /* Only the tail sections and stripe footers are touched, so disable read-ahead and prefetch the tail */
+  size_t tail_size = reader->size < ORC__READER_TAIL_SIZE ? reader->size : ORC__READER_TAIL_SIZE;
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t tail_offset = (reader->size-tail_size) & ~(page_size-1);
+  madvise(mapping, reader->size, MADV_RANDOM);
+  madvise((uint8_t *) mapping+tail_offset, reader->size-tail_offset, MADV_WILLNEED);
+  return reader;
+}
+
+/* The buffer is borrowed and is treated as the whole file, so it must outlive the reader */
+orc__reader_t *orc__reader__init_from_buffer(uint8_t *data, size_t size, int enable_stripe_stats, int enable_stripes) {
+  orc__reader_t *reader;
+  if ((reader = orc__reader__alloc(enable_stripe_stats, enable_stripes, ORC__READER_MODE_BUFFER)) == NULL) {
+    return NULL;
+  }
+  reader->size = size;
+  reader->data = data;
+  reader->data_size = size;
+  return reader;
+}
+
+/* Pointer to the byte `offset` bytes before the end of the file, which must be within the tail */
+uint8_t *orc__reader__tail(orc__reader_t *reader, uint64_t offset) {
+  return reader->data+(reader->data_size-offset);
+}
+
+int orc__reader__decode_post_script(orc__reader_t *reader) {
+  if (reader->data_size == 0) {
+    return ORC__NOSTREAM;
+  }
+  orc__buffer_t *post_script_buffer;
+  if ((post_script_buffer = orc__buffer__init_from_stream(reader->arena, reader->data)) == NULL) {
+    return ORC__ENOMEM;
+  }
 
   /* Post script length is the last byte of the file */
-  orc__buffer__forward(post_script_buffer, reader->size-1);
-  uint64_t post_script_length = *(uint64_t *) post_script_buffer->ptr & 0xff;
-  if (post_script_length > reader->size) {
+  orc__buffer__forward(post_script_buffer, reader->data_size-1);
+  reader->post_script_length = *post_script_buffer->ptr;
+  if (reader->post_script_length+1 > reader->data_size) {
     return ORC__NOSTREAM;
   }
 
   /* Set the buffer to the beginning of the post script */
-  orc__buffer__rewind_shift(post_script_buffer, post_script_length);
+  orc__buffer__rewind_shift(post_script_buffer, reader->post_script_length);
 
-  if ((reader->post_script = orc__proto__post_script__unpack(NULL, 
-                                                             post_script_buffer->size, 
-                                                             &post_script_buffer->head[0])) == NULL) {
+  if ((reader->post_script = orc__message__unpack_post_script(reader->arena, &post_script_buffer->head[0], 
+                                                              post_script_buffer->size, 
+                                                              reader->generic_unpack)) == NULL) {
     return ORC__NODECODE;
   }
   reader->post_script_decoded = 1;
-   
-  orc__buffer__free(post_script_buffer);
+  return ORC__OK;
+}
 
-  uint64_t footer_offset = 1+post_script_length+reader->post_script->footerlength; 
-  if (footer_offset > reader->size) {
+/* Number of trailing bytes needed to decode the footer, and the metadata if stripe stats are enabled.
+ * If the tail does not even hold the postscript, only the postscript length is reported. */
+int orc__reader__tail_length(orc__reader_t *reader, uint64_t *length) {
+  if (reader->data_size == 0) {
     return ORC__NOSTREAM;
   }
 
-  uint8_t *compressed_footer = (uint8_t *) reader->data+(reader->size-footer_offset);
-
-  /* Decode footer section */
-  orc__decompressor_t *decompressor;
-  if ((decompressor = orc__decompressor_init(reader->post_script->compression,
-                                             reader->post_script->compressionblocksize, 
-                                             compressed_footer, 
-                                             reader->post_script->footerlength)) == NULL) { 
-    return ORC__ENOMEM; 
+  uint64_t post_script_length = reader->data[reader->data_size-1];
+  if (post_script_length+1 > reader->data_size) {
+    *length = post_script_length+1;
+    return ORC__OK;
   }
 
   int status;
-  if ((status = orc__decompressor__decode(decompressor)) != ORC__OK) {
-    orc__decompressor__free(decompressor);
+  if ((status = orc__reader__decode_post_script(reader)) != ORC__OK) {
     return status;
   }
 
-  if ((reader->footer = orc__proto__footer__unpack(NULL, 
-                                                   decompressor->output->size, 
-                                                   &decompressor->output->head[0])) == NULL) {
-      orc__decompressor__free(decompressor);
-      return ORC__NODECODE;
+  *length = 1+post_script_length+reader->post_script->footerlength;
+  if (reader->enable_stripe_stats) {
+    *length += reader->post_script->metadatalength;
   }
-  reader->footer_decoded = 1;
+  return ORC__OK;
+}
 
-  orc__decompressor__free(decompressor);
+int orc__reader__compare_columns(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return (x > y)-(x < y);
+}
 
-  /* Decode metadata section */
-  if (reader->enable_stripe_stats) {
-    uint64_t metadata_offset = footer_offset+reader->post_script->metadatalength;
-    if (metadata_offset > reader->size) {
-      return ORC__NOSTREAM;
+/* Restrict the decoded file and stripe statistics to the given columns. They are kept sorted rather than as
+ * a map, whose size would be set by the largest index however few columns are selected. */
+int orc__reader__select_columns(orc__reader_t *reader, uint64_t *columns, size_t n) {
+  size_t i, n_columns = 0;
+  if ((reader->columns = orc__arena__alloc(reader->arena, sizeof(uint64_t)*n)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  memcpy(reader->columns, columns, sizeof(uint64_t)*n);
+  qsort(reader->columns, n, sizeof(uint64_t), orc__reader__compare_columns);
+
+  for (i=0; i < n; ++i) {
+    if (n_columns == 0 || reader->columns[i] != reader->columns[n_columns-1]) {
+      reader->columns[n_columns++] = reader->columns[i];
     }
+  }
+  reader->n_columns = n_columns;
+  return ORC__OK;
+}
+
+int orc__reader__column_selected(orc__reader_t *reader, size_t column) {
+  if (reader->columns == NULL) {
+    return 1;
+  }
 
-    uint8_t *compressed_metadata  = (uint8_t *) reader->data+(reader->size-metadata_offset); 
-    if ((decompressor = orc__decompressor_init(reader->post_script->compression,
-                                               reader->post_script->compressionblocksize, 
-                                               compressed_metadata, 
-                                               reader->post_script->metadatalength)) == NULL) { 
-      return ORC__ENOMEM; 
+  size_t low = 0, high = reader->n_columns, middle;
+  while (low < high) {
+    middle = low+(high-low)/2;
+    if (reader->columns[middle] < column) {
+      low = middle+1;
+    }
+    else {
+      high = middle;
     }
+  }
+  return low < reader->n_columns && reader->columns[low] == column;
+}
 
-    if ((status = orc__decompressor__decode(decompressor)) != ORC__OK) {
-      orc__decompressor__free(decompressor);
-      return status;
+/* Number of the first n columns whose statistics are decoded */
+size_t orc__reader__selected_columns(orc__reader_t *reader, size_t n) {
+  size_t i, count = 0;
+  for (i=0; i < n; ++i) {
+    count += orc__reader__column_selected(reader, i);
+  }
+  return count;
+}
+
+/* Length of a string of a footer or metadata message. String views lie within one of the decompressed
+ * sections and are not NUL terminated, messages which fell back to protobuf-c hold copies which are. */
+size_t orc__reader__string_length(orc__reader_t *reader, const char *value) {
+  const uint8_t *bytes = (const uint8_t *) value;
+  if ((bytes >= reader->footer_section.start && bytes < reader->footer_section.end) ||
+      (bytes >= reader->metadata_section.start && bytes < reader->metadata_section.end)) {
+    return orc__wire__prefixed_length(bytes);
+  }
+  return strlen(value);
+}
+
+/* Unpack the occurrences of a repeated ColumnStatistics field, one per column. Unselected columns are 
+ * skipped over at the wire level and left NULL, so entries keep their column index. */
+int orc__reader__decode_column_statistics(orc__reader_t *reader, uint8_t *data, uint8_t *end, uint32_t field,
+                                          size_t *n_statistics, Orc__Proto__ColumnStatistics ***statistics) {
+  size_t count;
+  if (orc__wire__count(data, end, field, &count) != ORC__OK) {
+    return ORC__NODECODE;
+  }
+
+  *n_statistics = 0;
+  *statistics = NULL;
+  if (count > 0 && (*statistics = orc__arena__alloc(reader->arena, sizeof(void *)*count)) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  uint8_t *ptr = data;
+  uint8_t *value;
+  size_t length;
+  uint32_t tag_field;
+  uint8_t wire_type;
+  Orc__Proto__ColumnStatistics *column;
+
+  while (ptr < end) {
+    if (orc__wire__tag(&ptr, end, &tag_field, &wire_type) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    if (tag_field != field) {
+      if (orc__wire__skip(&ptr, end, wire_type) != ORC__OK) {
+        return ORC__NODECODE;
+      }
+      continue;
+    }
+    if (orc__wire__bytes(&ptr, end, &value, &length) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+
+    column = NULL;
+    if (orc__reader__column_selected(reader, *n_statistics)) {
+      if ((column = orc__message__unpack_column_statistics(reader->arena, value, length, reader->generic_unpack,
+                                                           reader->string_views)) == NULL) {
+        return ORC__NODECODE;
+      }
+    }
+    (*statistics)[(*n_statistics)++] = column;
+  }
+  return ORC__OK;
+}
+
+/* Index the StripeStatistics of the metadata section without decoding them, they are 
+ * decoded one at a time by orc__reader__decode_stripe_statistics */
+int orc__reader__index_metadata(orc__reader_t *reader, uint8_t *data, size_t size) {
+  Orc__Proto__Metadata *metadata;
+  if ((metadata = orc__arena__alloc(reader->arena, sizeof(Orc__Proto__Metadata))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__metadata__init(metadata);
+
+  uint8_t *ptr = data;
+  uint8_t *end = data+size;
+  size_t count;
+  if (orc__wire__count(ptr, end, 1, &count) != ORC__OK) {
+    return ORC__NODECODE;
+  }
+  if (count > 0) {
+    if ((metadata->stripestats = orc__arena__alloc(reader->arena, sizeof(void *)*count)) == NULL ||
+        (reader->stripe_stats = orc__arena__alloc(reader->arena, sizeof(orc__span_t)*count)) == NULL) {
+      return ORC__ENOMEM;
     }
+  }
+
+  uint8_t *value;
+  size_t length;
+  uint32_t field;
+  uint8_t wire_type;
 
-    if ((reader->metadata = orc__proto__metadata__unpack(NULL, 
-                                                         decompressor->output->size, 
-                                                         &decompressor->output->head[0])) == NULL) {
-      orc__decompressor__free(decompressor);
+  while (ptr < end) {
+    if (orc__wire__tag(&ptr, end, &field, &wire_type) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    if (field != 1) {
+      if (orc__wire__skip(&ptr, end, wire_type) != ORC__OK) {
+        return ORC__NODECODE;
+      }
+      continue;
+    }
+    if (wire_type != ORC__WIRE_TYPE__LENGTH_DELIMITED || orc__wire__bytes(&ptr, end, &value, &length) != ORC__OK) {
       return ORC__NODECODE;
     }
-    reader->metadata_decoded = 1;
 
-    orc__decompressor__free(decompressor);
+    reader->stripe_stats[metadata->n_stripestats].start = value;
+    reader->stripe_stats[metadata->n_stripestats].end = value+length;
+    metadata->stripestats[metadata->n_stripestats++] = NULL;
   }
-  
-  /* Decode Stripe Footers */
-  if (reader->enable_stripes) {
-    uint64_t file_length = footer_offset+reader->post_script->metadatalength+reader->footer->contentlength;
-    if ((uint64_t) reader->size < file_length) {
-      return ORC__NOSTREAM;
+
+  reader->metadata = metadata;
+  reader->metadata_decoded = 1;
+  return ORC__OK;
+}
+
+/* Decode the statistics of stripe i, of the selected columns only */
+int orc__reader__decode_stripe_statistics(orc__reader_t *reader, size_t i) {
+  if (!reader->metadata_decoded || i >= reader->metadata->n_stripestats) {
+    return ORC__NOSTREAM;
+  }
+  if (reader->metadata->stripestats[i] != NULL) {
+    return ORC__OK;
+  }
+
+  Orc__Proto__StripeStatistics *stripe;
+  if ((stripe = orc__arena__alloc(reader->arena, sizeof(Orc__Proto__StripeStatistics))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__stripe_statistics__init(stripe);
+
+  int status;
+  if ((status = orc__reader__decode_column_statistics(reader, reader->stripe_stats[i].start, 
+                                                      reader->stripe_stats[i].end, 1, 
+                                                      &stripe->n_colstats, &stripe->colstats)) != ORC__OK) {
+    return status;
+  }
+  reader->metadata->stripestats[i] = stripe;
+  return ORC__OK;
+}
+
+/* Decode the statistics of the stripes in [start, stop), stop is clamped to the number of stripes */
+int orc__reader__decode_stripe_statistics_range(orc__reader_t *reader, size_t start, size_t stop) {
+  if (!reader->metadata_decoded) {
+    return ORC__NOSTREAM;
+  }
+  if (stop > reader->metadata->n_stripestats) {
+    stop = reader->metadata->n_stripestats;
+  }
+
+  int status;
+  for (; start < stop; ++start) {
+    if ((status = orc__reader__decode_stripe_statistics(reader, start)) != ORC__OK) {
+      return status;
     }
- 
-    int i;
-    uint64_t stripe_offset;
-    reader->stripe_footers = malloc(sizeof(Orc__Proto__StripeFooter *)*reader->footer->n_stripes);
-    for (i=0; i < reader->footer->n_stripes; ++i) {
-      stripe_offset = reader->footer->stripes[i]->offset;
-      stripe_offset += reader->footer->stripes[i]->indexlength;
-      stripe_offset += reader->footer->stripes[i]->datalength;
-    
-      uint8_t *compressed_stripe  = (uint8_t *) reader->data+(stripe_offset); 
-      if ((decompressor = orc__decompressor_init(reader->post_script->compression,
-                                                 reader->post_script->compressionblocksize, 
-                                                 compressed_stripe, 
-                                                 reader->footer->stripes[i]->footerlength)) == NULL) { 
-        return ORC__ENOMEM; 
+  }
+  return ORC__OK;
+}
+
+/* Decode the scalar fields of the footer and record where its repeated fields are, without unpacking them */
+int orc__reader__scan_footer(orc__reader_t *reader, uint8_t *data, size_t size) {
+  Orc__Proto__Footer *footer;
+  if ((footer = orc__arena__alloc(reader->arena, sizeof(Orc__Proto__Footer))) == NULL) {
+    return ORC__ENOMEM;
+  }
+  orc__proto__footer__init(footer);
+
+  uint8_t *ptr = data;
+  uint8_t *end = data+size;
+  uint8_t *tag_start;
+  uint32_t field;
+  uint8_t wire_type;
+  uint64_t value;
+  orc__field_range_t *range;
+
+  while (ptr < end) {
+    tag_start = ptr;
+    if (orc__wire__tag(&ptr, end, &field, &wire_type) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+
+    if (field == ORC__FOOTER_FIELD__STRIPES || field == ORC__FOOTER_FIELD__TYPES ||
+        field == ORC__FOOTER_FIELD__METADATA || field == ORC__FOOTER_FIELD__STATISTICS) {
+      if (wire_type != ORC__WIRE_TYPE__LENGTH_DELIMITED || orc__wire__skip(&ptr, end, wire_type) != ORC__OK) {
+        return ORC__NODECODE;
       }
-    
-      if ((status = orc__decompressor__decode(decompressor)) != ORC__OK) {
-        orc__decompressor__free(decompressor);
-        return status;
+      range = &reader->footer_fields[field];
+      if (range->count == 0) {
+        range->start = tag_start;
       }
+      range->end = ptr;
+      range->count += 1;
+      continue;
+    }
 
-      if ((reader->stripe_footers[i] = orc__proto__stripe_footer__unpack(NULL, 
-                                                                         decompressor->output->size, 
-                                                                         &decompressor->output->head[0])) == NULL) {
-        orc__decompressor__free(decompressor);
+    if (field > 9) {
+      if (orc__wire__skip(&ptr, end, wire_type) != ORC__OK) {
         return ORC__NODECODE;
       }
+      continue;
+    }
 
-      orc__decompressor__free(decompressor);
-      reader->stripes_decoded += 1;
+    if (wire_type != ORC__WIRE_TYPE__VARINT || orc__wire__varint(&ptr, end, &value) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    if (field == 1) {
+      footer->has_headerlength = 1;
+      footer->headerlength = value;
+    }
+    if (field == 2) {
+      footer->has_contentlength = 1;
+      footer->contentlength = value;
+    }
+    if (field == 6) {
+      footer->has_numberofrows = 1;
+      footer->numberofrows = value;
+    }
+    if (field == 8) {
+      footer->has_rowindexstride = 1;
+      footer->rowindexstride = value;
+    }
+    if (field == 9) {
+      footer->has_writer = 1;
+      footer->writer = value;
     }
   }
 
-  return status;
+  reader->footer = footer;
+  reader->footer_decoded = 1;
+  return ORC__OK;
 }
 
-void orc__reader__free(orc__reader_t *reader) {
-  if (reader->enable_stripe_stats && reader->metadata_decoded) {
-    orc__proto__metadata__free_unpacked(reader->metadata, NULL);
-  }
-  if (reader->enable_stripes && reader->stripes_decoded) {
-    int i;
-    for (i=0; i < reader->stripes_decoded; ++i) {
-      if (reader->stripe_footers[i] != NULL) {
-        orc__proto__stripe_footer__free_unpacked(reader->stripe_footers[i], NULL);
+/* Unpack every occurrence of one of the repeated footer fields recorded by orc__reader__scan_footer */
+int orc__reader__decode_footer_field(orc__reader_t *reader, uint32_t field) {
+  orc__field_range_t *range = &reader->footer_fields[field];
+  if (range->decoded) {
+    return ORC__OK;
+  }
+
+  /* Statistics are subject to the column selection */
+  if (field == ORC__FOOTER_FIELD__STATISTICS) {
+    int status;
+    if ((status = orc__reader__decode_column_statistics(reader, range->start, range->end, field,
+                                                        &reader->footer->n_statistics,
+                                                        &reader->footer->statistics)) != ORC__OK) {
+      return status;
+    }
+    range->decoded = 1;
+    return ORC__OK;
+  }
+
+  void **messages = NULL;
+  if (range->count > 0 && (messages = orc__arena__alloc(reader->arena, sizeof(void *)*range->count)) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  uint8_t *ptr = range->start;
+  uint8_t *value;
+  size_t length, n = 0;
+  uint32_t tag_field;
+  uint8_t wire_type;
+
+  /* Other fields are only found in the range when the writer interleaved them */
+  while (ptr < range->end) {
+    if (orc__wire__tag(&ptr, range->end, &tag_field, &wire_type) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    if (tag_field != field) {
+      if (orc__wire__skip(&ptr, range->end, wire_type) != ORC__OK) {
+        return ORC__NODECODE;
       }
+      continue;
+    }
+    if (orc__wire__bytes(&ptr, range->end, &value, &length) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+
+    if (field == ORC__FOOTER_FIELD__STRIPES) {
+      messages[n] = orc__message__unpack_stripe_information(reader->arena, value, length, reader->generic_unpack);
+    }
+    if (field == ORC__FOOTER_FIELD__TYPES) {
+      messages[n] = orc__message__unpack_type(reader->arena, value, length, reader->generic_unpack,
+                                              reader->string_views);
+    }
+    if (field == ORC__FOOTER_FIELD__METADATA) {
+      messages[n] = orc__message__unpack_user_metadata_item(reader->arena, value, length, reader->generic_unpack,
+                                                            reader->string_views);
+    }
+    if (messages[n++] == NULL) {
+      return ORC__NODECODE;
     }
   }
-  if (reader->post_script_decoded) {
-    orc__proto__post_script__free_unpacked(reader->post_script, NULL);
+
+  if (field == ORC__FOOTER_FIELD__STRIPES) {
+    reader->footer->n_stripes = n;
+    reader->footer->stripes = (Orc__Proto__StripeInformation **) messages;
   }
-  if (reader->footer_decoded) {
-    orc__proto__footer__free_unpacked(reader->footer, NULL);
+  if (field == ORC__FOOTER_FIELD__TYPES) {
+    reader->footer->n_types = n;
+    reader->footer->types = (Orc__Proto__Type **) messages;
   }
+  if (field == ORC__FOOTER_FIELD__METADATA) {
+    reader->footer->n_metadata = n;
+    reader->footer->metadata = (Orc__Proto__UserMetadataItem **) messages;
+  }
+  range->decoded = 1;
+  return ORC__OK;
+}
 
-  free((uint8_t *) reader->data);
-  free(reader);
+/* Offset of the start of the footer from the end of the file */
+uint64_t orc__reader__footer_offset(orc__reader_t *reader) {
+  return 1+reader->post_script_length+reader->post_script->footerlength;
 }
 
-int orc__reader__file_to_buffer(orc__reader_t *reader) {
-  FILE *fp;
+/* Decode the postscript and scan the footer, unpacking the footer fields enabled on the reader */
+int orc__reader__decode_footer(orc__reader_t *reader) {
+  int status;
+  if ((status = orc__reader__decode_post_script(reader)) != ORC__OK) {
+    return status;
+  }
+
+  uint64_t footer_offset = orc__reader__footer_offset(reader);
+  if (footer_offset > reader->size) {
+    return ORC__NOSTREAM;
+  }
 
-  fp = fopen(reader->input_path, "rb");
-  if (!fp) { 
-    return errno; 
+  /* Read the rest of the footer and metadata in one go if the speculative tail was too short */
+  uint64_t tail_size = footer_offset;
+  if (reader->enable_stripe_stats && footer_offset+reader->post_script->metadatalength <= reader->size) {
+    tail_size += reader->post_script->metadatalength;
   }
-  
-  fseek(fp, 0, SEEK_END);
-  reader->size = ftell(fp);
-  fseek(fp, 0, SEEK_SET);
 
-  reader->data = malloc(sizeof(uint8_t *) * (reader->size));
-  if (!reader->data) { 
-    fclose(fp); 
+  if (tail_size > reader->data_size) {
+    if ((status = orc__reader__read_tail(reader, tail_size)) != ORC__OK) {
+      return status;
+    }
+  }
+
+  uint8_t *compressed_footer = orc__reader__tail(reader, footer_offset);
+
+  /* Decode footer section */
+  orc__decompressor_t *decompressor;
+  if ((decompressor = orc__decompressor_init(reader->arena, reader->post_script->compression,
+                                             reader->post_script->compressionblocksize,
+                                             compressed_footer,
+                                             reader->post_script->footerlength)) == NULL) {
     return ORC__ENOMEM;
   }
+  decompressor->threads = reader->decompress_threads;
 
-  size_t ret = fread((uint8_t *) reader->data, reader->size, 1, fp);
-  if (ret != reader->size) {
-    fclose(fp);
-    return ORC__NODECODE;
+  if ((status = orc__decompressor__decode(decompressor)) != ORC__OK) {
+    return status;
   }
-  fclose(fp);
 
+  /* The decompressed footer stays in the arena, so its repeated fields can be unpacked later on */
+  reader->footer_section.start = decompressor->output->head;
+  reader->footer_section.end = decompressor->output->head+decompressor->output->size;
+  if ((status = orc__reader__scan_footer(reader, decompressor->output->head, decompressor->output->size)) != ORC__OK) {
+    return status;
+  }
+
+  if (reader->enable_schema) {
+    if ((status = orc__reader__decode_footer_field(reader, ORC__FOOTER_FIELD__TYPES)) != ORC__OK) {
+      return status;
+    }
+  }
+  if (reader->enable_file_stats) {
+    if ((status = orc__reader__decode_footer_field(reader, ORC__FOOTER_FIELD__STATISTICS)) != ORC__OK) {
+      return status;
+    }
+  }
+  if (reader->enable_stripes) {
+    if ((status = orc__reader__decode_footer_field(reader, ORC__FOOTER_FIELD__STRIPES)) != ORC__OK) {
+      return status;
+    }
+  }
   return ORC__OK;
 }
+
+/* Decompress and index the metadata section, the statistics of each stripe are decoded on demand.
+ * The tail is extended first if the metadata was not part of it. */
+int orc__reader__decode_metadata(orc__reader_t *reader) {
+  if (reader->metadata_decoded) {
+    return ORC__OK;
+  }
+  if (!reader->footer_decoded) {
+    return ORC__NOSTREAM;
+  }
+
+  int status;
+  uint64_t metadata_offset = orc__reader__footer_offset(reader)+reader->post_script->metadatalength;
+  if (metadata_offset > reader->size) {
+    return ORC__NOSTREAM;
+  }
+  if (metadata_offset > reader->data_size) {
+    if ((status = orc__reader__read_tail(reader, metadata_offset)) != ORC__OK) {
+      return status;
+    }
+  }
+
+  orc__decompressor_t *decompressor;
+  uint8_t *compressed_metadata = orc__reader__tail(reader, metadata_offset);
+  if ((decompressor = orc__decompressor_init(reader->arena, reader->post_script->compression,
+                                             reader->post_script->compressionblocksize,
+                                             compressed_metadata,
+                                             reader->post_script->metadatalength)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  decompressor->threads = reader->decompress_threads;
+
+  if ((status = orc__decompressor__decode(decompressor)) != ORC__OK) {
+    return status;
+  }
+
+  reader->metadata_section.start = decompressor->output->head;
+  reader->metadata_section.end = decompressor->output->head+decompressor->output->size;
+  return orc__reader__index_metadata(reader, decompressor->output->head, decompressor->output->size);
+}
+
+/* Fetch, decompress and unpack the footer of stripe i, which is read from the file at that point */
+int orc__reader__decode_stripe_footer(orc__reader_t *reader, size_t i) {
+  int status;
+  if ((status = orc__reader__decode_footer_field(reader, ORC__FOOTER_FIELD__STRIPES)) != ORC__OK) {
+    return status;
+  }
+  if (i >= reader->footer->n_stripes) {
+    return ORC__NOSTREAM;
+  }
+  if (reader->stripe_footers != NULL && reader->stripe_footers[i] != NULL) {
+    return ORC__OK;
+  }
+
+  uint64_t file_length = orc__reader__footer_offset(reader)+reader->post_script->metadatalength;
+  file_length += reader->footer->contentlength;
+  if ((uint64_t) reader->size < file_length) {
+    return ORC__NOSTREAM;
+  }
+
+  if (reader->stripe_footers == NULL) {
+    size_t size = sizeof(Orc__Proto__StripeFooter *)*reader->footer->n_stripes;
+    if ((reader->stripe_footers = orc__arena__alloc(reader->arena, size)) == NULL) {
+      return ORC__ENOMEM;
+    }
+    memset(reader->stripe_footers, 0, size);
+  }
+  if (reader->stripe_arena == NULL && (reader->stripe_arena = orc__arena__init()) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  uint64_t stripe_offset = reader->footer->stripes[i]->offset;
+  stripe_offset += reader->footer->stripes[i]->indexlength;
+  stripe_offset += reader->footer->stripes[i]->datalength;
+
+  /* Only the stripe footer byte range is read from the file */
+  uint8_t *compressed_stripe;
+  if ((status = orc__reader__fetch(reader, stripe_offset, reader->footer->stripes[i]->footerlength,
+                                   &compressed_stripe)) != ORC__OK) {
+    return status;
+  }
+
+  orc__decompressor_t *decompressor;
+  if ((decompressor = orc__decompressor_init(reader->stripe_arena, reader->post_script->compression,
+                                             reader->post_script->compressionblocksize,
+                                             compressed_stripe,
+                                             reader->footer->stripes[i]->footerlength)) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  if ((status = orc__decompressor__decode(decompressor)) == ORC__OK) {
+    if ((reader->stripe_footers[i] = orc__message__unpack_stripe_footer(reader->arena,
+                                                                        &decompressor->output->head[0],
+                                                                        decompressor->output->size,
+                                                                        reader->generic_unpack)) == NULL) {
+      status = ORC__NODECODE;
+    }
+    else {
+      reader->stripes_decoded += 1;
+    }
+  }
+
+  /* The unpacked footer does not point into the decompressed bytes, which are only bounded by the
+   * compression block size and would otherwise pile up across many stripes */
+  orc__arena__reset(reader->stripe_arena);
+  return status;
+}
+
+int orc__reader__decode(orc__reader_t *reader) {
+  int status;
+  if ((status = orc__reader__decode_footer(reader)) != ORC__OK) {
+    return status;
+  }
+
+  if (reader->enable_stripe_stats) {
+    if ((status = orc__reader__decode_metadata(reader)) != ORC__OK) {
+      return status;
+    }
+  }
+
+  /* Decode Stripe Footers */
+  if (reader->enable_stripes) {
+    size_t i;
+    for (i=0; i < reader->footer->n_stripes; ++i) {
+      if ((status = orc__reader__decode_stripe_footer(reader, i)) != ORC__OK) {
+        return status;
+      }
+    }
+  }
+  return ORC__OK;
+}
+
+/* Decoded messages live in the arena, so only the mapping and the file need releasing separately */
+void orc__reader__free(orc__reader_t *reader) {
+  if (reader->mode == ORC__READER_MODE_MMAP) {
+    if (reader->data != NULL) {
+      munmap(reader->data, reader->data_size);
+    }
+  }
+
+  if (reader->fd >= 0) {
+    close(reader->fd);
+  }
+  if (reader->stripe_arena != NULL) {
+    orc__arena__free(reader->stripe_arena);
+  }
+  orc__arena__free(reader->arena);
+}
+
+int orc__reader__pread(orc__reader_t *reader, uint8_t *output, size_t length, uint64_t offset) {
+  ssize_t ret;
+  while (length > 0) {
+    if ((ret = pread(reader->fd, output, length, offset)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return ORC__NODECODE;
+    }
+    if (ret == 0) {
+      return ORC__NOSTREAM;
+    }
+    output += ret;
+    offset += ret;
+    length -= ret;
+  }
+  return ORC__OK;
+}
+
+/* Grow the tail buffer to the trailing tail_size bytes of the file, only reading what is missing.
+ * The previous, shorter tail is left to the arena. */
+int orc__reader__read_tail(orc__reader_t *reader, size_t tail_size) {
+  uint8_t *data;
+  if ((data = orc__arena__alloc(reader->arena, tail_size)) == NULL) {
+    errno = ENOMEM;
+    return ORC__ENOMEM;
+  }
+
+  size_t missing = tail_size-reader->data_size;
+  int status;
+  if ((status = orc__reader__pread(reader, data, missing, reader->size-tail_size)) != ORC__OK) {
+    return status;
+  }
+
+  if (reader->data_size > 0) {
+    memcpy(data+missing, reader->data, reader->data_size);
+  }
+  reader->data = data;
+  reader->data_size = tail_size;
+  return ORC__OK;
+}
+
+/* Point output at the given byte range of the file, reading it unless it is part of the tail */
+int orc__reader__fetch(orc__reader_t *reader, uint64_t offset, uint64_t length, uint8_t **output) {
+  if (offset+length > reader->size) {
+    return ORC__NOSTREAM;
+  }
+
+  uint64_t tail_offset = reader->size-reader->data_size;
+  if (offset >= tail_offset) {
+    *output = reader->data+(offset-tail_offset);
+    return ORC__OK;
+  }
+
+  /* Grown geometrically so that the discarded scratch buffers stay a fraction of the arena */
+  if (length > reader->scratch_size) {
+    uint64_t scratch_size = reader->scratch_size ? reader->scratch_size : length;
+    while (scratch_size < length) {
+      scratch_size *= 2;
+    }
+    uint8_t *scratch;
+    if ((scratch = orc__arena__alloc(reader->arena, scratch_size)) == NULL) {
+      return ORC__ENOMEM;
+    }
+    reader->scratch = scratch;
+    reader->scratch_size = scratch_size;
+  }
+
+  *output = reader->scratch;
+  return orc__reader__pread(reader, reader->scratch, length, offset);
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <stdio.h>
+#include <string.h>
+#include "core.h"
+#include "arena.h"
+#include "reader.h"
+
+
+/* Longest parameter list of a type, "(4294967295,4294967295)" */
+#define ORC__SCHEMA_PARAMETERS_SIZE  24
+
+
+/* Compound type on the stack of orc__schema__render, along with the next of its subtypes to render */
+typedef struct orc__schema_frame_t {
+  Orc__Proto__Type *type;
+  size_t child;
+} orc__schema_frame_t;
+
+
+/* Hive name of a type kind, compound kinds include the opening bracket. NULL for unknown kinds. */
+const char *orc__schema__kind_name(Orc__Proto__Type__Kind kind) {
+  switch (kind) {
+    case ORC__TYPE_KIND__BOOLEAN:    return "boolean";
+    case ORC__TYPE_KIND__BYTE:       return "byte";
+    case ORC__TYPE_KIND__SHORT:      return "tinyint";
+    case ORC__TYPE_KIND__INT:        return "int";
+    case ORC__TYPE_KIND__LONG:       return "bigint";
+    case ORC__TYPE_KIND__FLOAT:      return "float";
+    case ORC__TYPE_KIND__DOUBLE:     return "double";
+    case ORC__TYPE_KIND__STRING:     return "string";
+    case ORC__TYPE_KIND__BINARY:     return "binary";
+    case ORC__TYPE_KIND__TIMESTAMP:  return "timestamp";
+    case ORC__TYPE_KIND__LIST:       return "array<";
+    case ORC__TYPE_KIND__MAP:        return "map<";
+    case ORC__TYPE_KIND__STRUCT:     return "struct<";
+    case ORC__TYPE_KIND__UNION:      return "union<";
+    case ORC__TYPE_KIND__DECIMAL:    return "decimal";
+    case ORC__TYPE_KIND__DATE:       return "date";
+    case ORC__TYPE_KIND__VARCHAR:    return "varchar";
+    case ORC__TYPE_KIND__CHAR:       return "char";
+    default:                         return NULL;
+  }
+}
+
+int orc__schema__compound(Orc__Proto__Type__Kind kind) {
+  return kind == ORC__TYPE_KIND__LIST || kind == ORC__TYPE_KIND__MAP || kind == ORC__TYPE_KIND__STRUCT ||
+         kind == ORC__TYPE_KIND__UNION;
+}
+
+/* Append size bytes at *length, only counting them when output is NULL */
+void orc__schema__append(char *output, size_t *length, const char *value, size_t size) {
+  if (output != NULL) {
+    memcpy(output+*length, value, size);
+  }
+  *length += size;
+}
+
+/* Append the name of a type along with its parameters, e.g. decimal(38,10) or varchar(255) */
+int orc__schema__open(Orc__Proto__Type *type, char *output, size_t *length) {
+  const char *name;
+  if ((name = orc__schema__kind_name(type->kind)) == NULL) {
+    return ORC__NODECODE;
+  }
+  orc__schema__append(output, length, name, strlen(name));
+
+  char parameters[ORC__SCHEMA_PARAMETERS_SIZE];
+  int size = 0;
+  if (type->kind == ORC__TYPE_KIND__DECIMAL && type->has_precision) {
+    size = snprintf(parameters, sizeof(parameters), "(%u,%u)", (unsigned) type->precision,
+                    (unsigned) (type->has_scale ? type->scale : 0));
+  }
+  else if ((type->kind == ORC__TYPE_KIND__VARCHAR || type->kind == ORC__TYPE_KIND__CHAR) &&
+           type->has_maximumlength) {
+    size = snprintf(parameters, sizeof(parameters), "(%u)", (unsigned) type->maximumlength);
+  }
+  orc__schema__append(output, length, parameters, size);
+  return ORC__OK;
+}
+
+/* Render the type tree rooted at the first type depth first without recursing, stack holds a frame per type.
+ * Every type is visited at most once, so subtypes referring back up the tree can not loop. */
+int orc__schema__render(orc__reader_t *reader, orc__schema_frame_t *stack, char *output, size_t *length) {
+  Orc__Proto__Type **types = reader->footer->types;
+  size_t n_types = reader->footer->n_types;
+  size_t depth = 0, visited = 1;
+  orc__schema_frame_t *frame;
+  Orc__Proto__Type *type;
+  const char *name;
+  uint32_t index;
+  int status;
+
+  *length = 0;
+  if (n_types == 0) {
+    return ORC__OK;
+  }
+  type = types[0];
+  for (;;) {
+    if ((status = orc__schema__open(type, output, length)) != ORC__OK) {
+      return status;
+    }
+    if (orc__schema__compound(type->kind)) {
+      stack[depth].type = type;
+      stack[depth].child = 0;
+      depth += 1;
+    }
+
+    /* Close every compound type whose subtypes are all rendered, then move on to the next subtype */
+    type = NULL;
+    while (depth > 0 && type == NULL) {
+      frame = &stack[depth-1];
+      if (frame->child == frame->type->n_subtypes) {
+        orc__schema__append(output, length, ">", 1);
+        depth -= 1;
+        continue;
+      }
+
+      if (frame->child > 0) {
+        orc__schema__append(output, length, ",", 1);
+      }
+      if (frame->child < frame->type->n_fieldnames) {
+        if ((name = frame->type->fieldnames[frame->child]) != NULL) {
+          orc__schema__append(output, length, name, orc__reader__string_length(reader, name));
+        }
+        orc__schema__append(output, length, ":", 1);
+      }
+
+      index = frame->type->subtypes[frame->child++];
+      if (index >= n_types || ++visited > n_types) {
+        return ORC__NODECODE;
+      }
+      type = types[index];
+    }
+    if (type == NULL) {
+      return ORC__OK;
+    }
+  }
+}
+
+/* Render the schema as a Hive type string into the arena of the reader, sized exactly by a first pass. The
+ * footer types must have been decoded, the output is not NUL terminated. */
+int orc__schema__build(orc__reader_t *reader, char **output, size_t *length) {
+  orc__schema_frame_t *stack;
+  if ((stack = orc__arena__alloc(reader->arena, sizeof(orc__schema_frame_t)*reader->footer->n_types)) == NULL) {
+    return ORC__ENOMEM;
+  }
+
+  int status;
+  if ((status = orc__schema__render(reader, stack, NULL, length)) != ORC__OK) {
+    return status;
+  }
+  if ((*output = orc__arena__alloc(reader->arena, *length)) == NULL) {
+    return ORC__ENOMEM;
+  }
+  return orc__schema__render(reader, stack, *output, length);
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <stdint.h>
+#include "core.h"
+
+
+/* Protobuf wire types, the low three bits of every field tag */
+#define ORC__WIRE_TYPE__VARINT            0
+#define ORC__WIRE_TYPE__64BIT             1
+#define ORC__WIRE_TYPE__LENGTH_DELIMITED  2
+#define ORC__WIRE_TYPE__32BIT             5
+
+
+/* Full tag of a field, as switched on by the message decoders */
+#define ORC__WIRE_TAG(field, wire_type)   ((uint64_t) (field) << 3 | (wire_type))
+
+typedef struct orc__span_t {
+  uint8_t *start;
+  uint8_t *end;
+} orc__span_t;
+
+
+int orc__wire__varint(uint8_t **ptr, uint8_t *end, uint64_t *value) {
+  uint64_t result = 0;
+  int shift;
+  for (shift=0; shift < 64; shift += 7) {
+    if (*ptr == end) {
+      return ORC__NODECODE;
+    }
+    uint8_t byte = *(*ptr)++;
+    result |= (uint64_t) (byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return ORC__OK;
+    }
+  }
+  return ORC__NODECODE;
+}
+
+/* Little endian 64 bit value, as used by double fields */
+int orc__wire__fixed64(uint8_t **ptr, uint8_t *end, uint64_t *value) {
+  if (end-*ptr < 8) {
+    return ORC__NODECODE;
+  }
+  uint64_t result = 0;
+  int i;
+  for (i=7; i >= 0; --i) {
+    result = (result << 8) | (*ptr)[i];
+  }
+  *ptr += 8;
+  *value = result;
+  return ORC__OK;
+}
+
+int64_t orc__wire__zigzag64(uint64_t value) {
+  return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+int32_t orc__wire__zigzag32(uint32_t value) {
+  return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+/* Read a field tag, splitting it into the field number and wire type */
+int orc__wire__tag(uint8_t **ptr, uint8_t *end, uint32_t *field, uint8_t *wire_type) {
+  uint64_t tag;
+  if (orc__wire__varint(ptr, end, &tag) != ORC__OK || (tag >> 3) == 0 || (tag >> 3) > UINT32_MAX) {
+    return ORC__NODECODE;
+  }
+  *field = tag >> 3;
+  *wire_type = tag & 7;
+  return ORC__OK;
+}
+
+/* Read the length prefix of a length delimited field and point value at its bytes */
+int orc__wire__bytes(uint8_t **ptr, uint8_t *end, uint8_t **value, size_t *length) {
+  uint64_t size;
+  if (orc__wire__varint(ptr, end, &size) != ORC__OK || size > (uint64_t) (end-*ptr)) {
+    return ORC__NODECODE;
+  }
+  *value = *ptr;
+  *length = size;
+  *ptr += size;
+  return ORC__OK;
+}
+
+/* Move past the value of a field with the given wire type */
+int orc__wire__skip(uint8_t **ptr, uint8_t *end, uint8_t wire_type) {
+  uint64_t value;
+  uint8_t *bytes;
+  size_t length;
+
+  if (wire_type == ORC__WIRE_TYPE__VARINT) {
+    return orc__wire__varint(ptr, end, &value);
+  }
+  if (wire_type == ORC__WIRE_TYPE__LENGTH_DELIMITED) {
+    return orc__wire__bytes(ptr, end, &bytes, &length);
+  }
+  if (wire_type == ORC__WIRE_TYPE__64BIT || wire_type == ORC__WIRE_TYPE__32BIT) {
+    length = wire_type == ORC__WIRE_TYPE__64BIT ? 8 : 4;
+    if ((size_t) (end-*ptr) < length) {
+      return ORC__NODECODE;
+    }
+    *ptr += length;
+    return ORC__OK;
+  }
+
+  /* Groups are not used by the ORC messages */
+  return ORC__NODECODE;
+}
+
+/* Number of occurrences of a field in a message */
+int orc__wire__count(uint8_t *ptr, uint8_t *end, uint32_t field, size_t *count) {
+  uint32_t tag_field;
+  uint8_t wire_type;
+
+  *count = 0;
+  while (ptr < end) {
+    if (orc__wire__tag(&ptr, end, &tag_field, &wire_type) != ORC__OK ||
+        orc__wire__skip(&ptr, end, wire_type) != ORC__OK) {
+      return ORC__NODECODE;
+    }
+    if (tag_field == field) {
+      *count += 1;
+    }
+  }
+  return ORC__OK;
+}
+
+/* Length of a length delimited value given only a pointer to its bytes, as kept by string views. The length
+ * prefix ends just before the bytes, every byte of it but the last has the continuation bit set, unlike
+ * the last byte of the tag preceding it. */
+size_t orc__wire__prefixed_length(const uint8_t *value) {
+  const uint8_t *ptr = value-1;
+  while (ptr[-1] & 0x80) {
+    --ptr;
+  }
+
+  uint64_t length = 0;
+  int shift;
+  for (shift=0; ptr < value; shift += 7) {
+    length |= (uint64_t) (*ptr++ & 0x7f) << shift;
+  }
+  return length;
+}
@@ -1,6 +1,41 @@
+import os
+import struct
+import sys
 import pickle as pkl
 import unittest
-from _orc_metadata import read_metadata, ORCReadException
+import io
+import mmap
+import json
+import datetime
+import re
+import tempfile
+import threading
+import time
+from xml.etree import ElementTree
+from xml.sax.saxutils import escape as xml_escape
+from _orc_metadata import (read_metadata, read_metadata_buffer,
+                           read_metadata_many, open_metadata,
+                           open_metadata_buffer, read_metadata_json,
+                           read_metadata_buffer_json, ColumnStats, StreamInfo,
+                           EncodingInfo, ORCReadException, compressions,
+                           tail_length, _read_metadata_buffer_generic)
+import orc_metadata.reader
+from orc_metadata.reader import read_metadata_s3, read_metadata_s3_concurrent
+
+if sys.version_info[0] < 3:
+    from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+    from SocketServer import ThreadingMixIn
+    from httplib import HTTPConnection
+    from urllib import quote, unquote
+    from urlparse import urlparse, parse_qs
+else:
+    from http.server import BaseHTTPRequestHandler, HTTPServer
+    from socketserver import ThreadingMixIn
+    from http.client import HTTPConnection
+    from urllib.parse import quote, unquote, urlparse, parse_qs
+
+S3_NAMESPACE = 'http://s3.amazonaws.com/doc/2006-03-01/'
+EPOCH = datetime.date(1970, 1, 1)
 
 
 TEST_CASES = [
@@ -27,6 +62,7 @@ TEST_CASES = [
     'demo-11-none',
     'demo-11-zlib',
     'demo-12-zlib',
+    'demo-12-zstd',
     'over1k_bloom',
     'TestOrcFile.testSnappy',
     'TestVectorOrcFile.testLz4',
@@ -34,42 +70,1016 @@ TEST_CASES = [
 ]
 
 
+def load_expected(filename):
+    # The expected outputs were pickled by Python 2, whose str is text
+    with open('test/expected_output/{f}.pkl'.format(f=filename), 'rb') as f:
+        if sys.version_info[0] < 3:
+            return pkl.load(f)
+        return pkl.load(f, encoding='utf-8')
+
+
+def pb_varint(value):
+    encoded = bytearray()
+    while value > 0x7f:
+        encoded.append(value & 0x7f | 0x80)
+        value >>= 7
+    encoded.append(value)
+    return bytes(encoded)
+
+
+def pb_message(*fields):
+    """Protobuf encoding of (field number, value) pairs, integers as varints
+    and bytes as length delimited values."""
+    encoded = b''
+    for number, value in fields:
+        if isinstance(value, bytes):
+            encoded += pb_varint(number << 3 | 2) + pb_varint(len(value))
+            encoded += value
+        else:
+            encoded += pb_varint(number << 3) + pb_varint(value)
+    return encoded
+
+
+def orc_file(footer):
+    """An uncompressed ORC file without stripes around the given footer."""
+    post_script = pb_message((1, len(footer)), (2, 0), (3, 262144), (4, 0),
+                             (4, 12), (5, 0), (6, 1), (8000, b'ORC'))
+    return b'ORC' + footer + post_script + struct.pack('B', len(post_script))
+
+
 class TestReader(unittest.TestCase):
 
+    def test__missing_file(self):
+        with self.assertRaises(IOError):
+            read_metadata('test/orc_files/missing.orc')
+
     def test__TestOrcFile_partial_all(self):
         with self.assertRaises(ORCReadException):
             read_metadata('test/orc_files/TestOrcFile.partial.orc',
                           file_stats=True, stripe_stats=True,
                           stripes=True)
 
+    def test__TestOrcFile_partial_all_mmap(self):
+        with self.assertRaises(ORCReadException):
+            read_metadata('test/orc_files/TestOrcFile.partial.orc',
+                          file_stats=True, stripe_stats=True,
+                          stripes=True, use_mmap=True)
+
+    def test__buffer_types(self):
+        path = 'test/orc_files/TestOrcFile.testStripeLevelStats.orc'
+        expected_content = read_metadata(path, schema=True, file_stats=True,
+                                         stripe_stats=True, stripes=True)
+        with open(path, 'rb') as f:
+            content = f.read()
+            buffers = [content, bytearray(content), memoryview(content),
+                       mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)]
+
+        for buf in buffers:
+            actual_content = read_metadata_buffer(buf, schema=True,
+                                                  file_stats=True,
+                                                  stripe_stats=True,
+                                                  stripes=True)
+            self.assertDictEqual(expected_content, actual_content)
+
+        # Text is not file contents, Python 3 must not encode it as such
+        if sys.version_info[0] >= 3:
+            text = content.decode('latin-1')
+            for func in [read_metadata_buffer, read_metadata_buffer_json,
+                         open_metadata_buffer, tail_length]:
+                with self.assertRaises(TypeError):
+                    func(text)
+
+    def test__string_views(self):
+        # Column 1 holds strings whose length prefixes take 1 to 3 bytes, one
+        # with a NUL inside. The string statistics of column 2 come twice,
+        # which only protobuf-c merges, so they are unpacked into copies.
+        long_name, long_max = b'a' * 200, b'x' * 20000
+        footer = pb_message(
+            (1, 3), (2, 3),
+            (4, pb_message((1, 12), (2, 1), (2, 2), (3, long_name),
+                           (3, b'b'))),
+            (4, pb_message((1, 7))), (4, pb_message((1, 7))),
+            (6, 2),
+            (7, pb_message((1, 2), (10, 0))),
+            (7, pb_message((1, 2), (4, pb_message((1, b'a\0b'),
+                                                  (2, long_max))), (10, 0))),
+            (7, pb_message((1, 2), (4, pb_message((1, b'c'), (2, b'd'))),
+                           (4, pb_message((2, b'e'))), (10, 1))),
+            (8, 10000))
+        content = orc_file(footer)
+
+        metadata = read_metadata_buffer(content, schema=True, file_stats=True,
+                                        stripe_stats=True, stripes=True)
+        self.assertEqual('struct<{}:string,b:string>'.format('a' * 200),
+                         metadata['schema'])
+        stats = metadata['File Statistics']
+        self.assertEqual(('a\0b', 'x' * 20000),
+                         (stats[1]['min'], stats[1]['max']))
+        self.assertEqual(('c', 'e'), (stats[2]['min'], stats[2]['max']))
+        self.assertEqual(metadata, json.loads(read_metadata_buffer_json(
+            content, schema=True, file_stats=True, stripe_stats=True,
+            stripes=True).decode('utf-8')))
+
+        # Copies made by protobuf-c end at the first NUL, which views keep
+        generic = _read_metadata_buffer_generic(content)
+        self.assertEqual('a', generic['File Statistics'][1]['min'])
+        generic['File Statistics'][1]['min'] = 'a\0b'
+        self.assertEqual(metadata, generic)
+
+    def test__generic_unpack(self):
+        for filename in compiled(TEST_CASES):
+            with open('test/orc_files/{f}.orc'.format(f=filename), 'rb') as f:
+                content = f.read()
+            self.assertEqual(_read_metadata_buffer_generic(content),
+                             read_metadata_buffer(content, schema=True,
+                                                  file_stats=True,
+                                                  stripe_stats=True,
+                                                  stripes=True))
+
+    def test__buffer_partial(self):
+        with open('test/orc_files/TestOrcFile.testSeek.orc', 'rb') as f:
+            content = f.read()
+        with self.assertRaises(ORCReadException):
+            read_metadata_buffer(content[-100:], file_stats=True)
+        with self.assertRaises(ORCReadException):
+            read_metadata_buffer(b'')
+
+    def test__parallel_decompression(self):
+        # The tail of demo-11-zlib recompressed into 1 KiB chunks, and into
+        # 8 KiB chunks which inflate to over 6 times their size
+        path = 'test/orc_files/demo-11-zlib.smallBlocks.orc'
+        expected_content = read_metadata('test/orc_files/demo-11-zlib.orc',
+                                         schema=True, file_stats=True,
+                                         stripe_stats=True)
+
+        for name, block_size in [('smallBlocks', 1024),
+                                 ('largeBlocks', 8192)]:
+            expected_content['compression_size'] = block_size
+            for threads in [1, 2, 4, 16]:
+                actual_content = read_metadata(
+                    'test/orc_files/demo-11-zlib.{}.orc'.format(name),
+                    schema=True, file_stats=True, stripe_stats=True,
+                    decompress_threads=threads)
+                self.assertDictEqual(expected_content, actual_content)
+
+        # Decompression threads are pooled, later reads start no new ones
+        if os.path.isdir('/proc/self/task'):
+            n_tasks = len(os.listdir('/proc/self/task'))
+            for _ in range(10):
+                read_metadata(path, file_stats=True, stripe_stats=True,
+                              decompress_threads=16)
+            self.assertEqual(n_tasks, len(os.listdir('/proc/self/task')))
+
+    def test__concurrent_read(self):
+        paths = ['test/orc_files/{f}.orc'.format(f=name)
+                 for name in compiled(['demo-11-zlib', 'demo-12-zstd',
+                                       'TestOrcFile.testSeek',
+                                       'over1k_bloom'])]
+        options = dict(schema=True, file_stats=True, stripe_stats=True,
+                       stripes=True)
+        expected_content = [read_metadata(path, **options) for path in paths]
+        actual_content = [None] * len(paths) * 4
+
+        def read(i):
+            actual_content[i] = read_metadata(paths[i % len(paths)],
+                                              **options)
+
+        threads = [threading.Thread(target=read, args=(i,))
+                   for i in range(len(actual_content))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for i, content in enumerate(actual_content):
+            self.assertDictEqual(expected_content[i % len(paths)], content)
+
+    def test__read_metadata_many(self):
+        paths = ['test/orc_files/{f}.orc'.format(f=name)
+                 for name in compiled(['demo-12-zstd', 'TestOrcFile.testSeek',
+                                       'decimal',
+                                       'TestOrcFile.testStripeLevelStats',
+                                       'over1k_bloom'])] * 3
+        options = [dict(schema=True, file_stats=True, stripe_stats=True,
+                        stripes=True),
+                   dict(file_stats=True, stripe_stats=True, columns=[0, 2],
+                        stripe_range=slice(-2, None)),
+                   dict(stripe_stats=True, use_mmap=True,
+                        stripe_range=slice(None, None, -2))]
+
+        for kwargs in options:
+            expected_content = [(path, read_metadata(path, **kwargs))
+                                for path in paths]
+            for threads in [1, 4, 32]:
+                actual_content = read_metadata_many(paths, threads=threads,
+                                                    **kwargs)
+                self.assertEqual(expected_content, actual_content)
+
+                actual_content = read_metadata_many(paths, threads=threads,
+                                                    ordered=False, **kwargs)
+                self.assertEqual(sorted(expected_content),
+                                 sorted(actual_content))
+
+    def test__read_metadata_many_mutated_paths(self):
+        # The paths are copied, so replacing them from another thread while
+        # the files are read changes neither the files read nor the result
+        names = ['demo-11-zlib', 'TestOrcFile.testSeek', 'over1k_bloom']
+        paths = ['test/orc_files/{f}.orc'.format(f=name)
+                 for name in names] * 20
+        expected_content = [(path, read_metadata(path, stripes=True))
+                            for path in paths]
+        done = threading.Event()
+
+        def mutate():
+            while not done.is_set():
+                paths[:] = [''.join(list(path)) for path in paths]
+
+        thread = threading.Thread(target=mutate)
+        thread.start()
+        try:
+            for _ in range(5):
+                actual_content = read_metadata_many(paths, threads=4,
+                                                    stripes=True)
+                self.assertEqual(expected_content, actual_content)
+        finally:
+            done.set()
+            thread.join()
+
+    def test__read_metadata_many_errors(self):
+        paths = ['test/orc_files/missing.orc',
+                 'test/orc_files/TestOrcFile.partial.orc',
+                 'test/orc_files/decimal.orc']
+        results = read_metadata_many(paths, threads=2, file_stats=True,
+                                     stripe_stats=True, stripes=True)
+        self.assertEqual(paths, [path for path, _ in results])
+        self.assertIsInstance(results[0][1], IOError)
+        self.assertIsInstance(results[1][1], ORCReadException)
+        self.assertEqual(read_metadata(paths[2], file_stats=True,
+                                       stripe_stats=True, stripes=True),
+                         results[2][1])
+
+        self.assertEqual([], read_metadata_many([]))
+        self.assertEqual(results[2:],
+                         read_metadata_many(iter(paths[2:]), file_stats=True,
+                                            stripe_stats=True, stripes=True))
+        with self.assertRaises(TypeError):
+            read_metadata_many(5)
+        with self.assertRaises(TypeError):
+            read_metadata_many(paths, stripe_range=(0, 1))
+        with self.assertRaises(ValueError):
+            read_metadata_many(paths, columns=[-1])
+
+    def test__open_metadata(self):
+        keys = ['rows', 'compression', 'version', 'compression_size',
+                'schema', 'File Statistics', 'Stripe Statistics', 'Stripes']
+        for name in compiled(['TestOrcFile.testStripeLevelStats', 'decimal',
+                              'demo-12-zstd', 'TestOrcFile.emptyFile']):
+            path = 'test/orc_files/{f}.orc'.format(f=name)
+            expected_content = read_metadata(path, schema=True,
+                                             file_stats=True,
+                                             stripe_stats=True, stripes=True)
+            with open(path, 'rb') as f:
+                buffer_metadata = open_metadata_buffer(f.read())
+            for metadata in [open_metadata(path),
+                             open_metadata(path, use_mmap=True),
+                             buffer_metadata]:
+                for key in keys:
+                    self.assertEqual(expected_content[key], metadata[key])
+
+            metadata = open_metadata(path)
+            self.assertEqual(expected_content['rows'], metadata.rows)
+            self.assertEqual(expected_content['schema'], metadata.schema)
+            self.assertEqual(expected_content['File Statistics'],
+                             metadata.file_stats)
+            self.assertEqual(len(expected_content['Stripes']),
+                             metadata.n_stripes)
+            for i, stats in enumerate(expected_content['Stripe Statistics']):
+                self.assertEqual(stats, metadata.stripe_stats(i))
+            n_stripes = metadata.n_stripes
+            for i, stripe in enumerate(expected_content['Stripes']):
+                self.assertEqual(stripe, metadata.stripe(i - n_stripes))
+            self.assertEqual(expected_content['Stripes'], metadata.stripes)
+
+    def test__open_metadata_lazy(self):
+        path = 'test/orc_files/TestOrcFile.testStripeLevelStats.orc'
+        full_content = read_metadata(path, file_stats=True, stripe_stats=True,
+                                     stripes=True)
+        metadata = open_metadata(path, columns=[0, 2])
+        self.assertIs(metadata.stripe_stats(-1), metadata.stripe_stats(-1))
+        self.assertEqual(
+            [s for s in full_content['Stripe Statistics'][-1]['statistics']
+             if s['column'] in (0, 2)],
+            metadata.stripe_stats(-1)['statistics'])
+        self.assertIs(metadata.stripe(1), metadata.stripe(1))
+        self.assertEqual(full_content['Stripes'][1], metadata.stripe(1))
+
+        with self.assertRaises(IndexError):
+            metadata.stripe_stats(len(full_content['Stripe Statistics']))
+        with self.assertRaises(IndexError):
+            metadata.stripe(-metadata.n_stripes - 1)
+        with self.assertRaises(KeyError):
+            metadata['stripes']
+        with self.assertRaises(IOError):
+            open_metadata('test/orc_files/missing.orc')
+        with self.assertRaises(ORCReadException):
+            open_metadata('test/orc_files/TestOrcFile.partial.orc').stripe(0)
+
+    def test__open_metadata_close(self):
+        path = 'test/orc_files/TestOrcFile.testStripeLevelStats.orc'
+        stripes = read_metadata(path, stripes=True)['Stripes']
+        n_fds = len(os.listdir('/proc/self/fd'))
+        for use_mmap in [False, True]:
+            with open_metadata(path, use_mmap=use_mmap) as metadata:
+                self.assertFalse(metadata.closed)
+                self.assertEqual(stripes[-1], metadata.stripe(-1))
+                table = metadata.stripe_table()
+            self.assertTrue(metadata.closed)
+            self.assertEqual(n_fds, len(os.listdir('/proc/self/fd')))
+
+            for access in [lambda: metadata.rows, lambda: metadata.stripes,
+                           lambda: metadata['schema'],
+                           lambda: metadata.stripe(0),
+                           lambda: metadata.column_stats([1]),
+                           metadata.stripe_table, table.__arrow_c_schema__,
+                           metadata.__enter__]:
+                with self.assertRaises(ValueError):
+                    access()
+            metadata.close()
+
+        # The buffer can be resized again once it is released
+        with open(path, 'rb') as f:
+            content = bytearray(f.read())
+        metadata = open_metadata_buffer(content)
+        with self.assertRaises(BufferError):
+            content.extend(b'ORC')
+        metadata.close()
+        content.extend(b'ORC')
+
+    def test__schema(self):
+        path = 'test/orc_files/TestOrcFile.testUnionAndTimestamp.orc'
+        schema = read_metadata(path, schema=True)['schema']
+        self.assertEqual('struct<time:timestamp,union:union<int,string>,'
+                         'decimal:decimal(38,18)>', schema)
+        self.assertIs(schema, read_metadata(path, schema=True)['schema'])
+        self.assertIs(schema, open_metadata(path).schema)
+
+    def test__shared_names(self):
+        first, second = [
+            read_metadata('test/orc_files/{f}.orc'.format(f=name),
+                          file_stats=True, stripes=True)
+            for name in ['demo-11-zlib', 'demo-12-zlib']]
+        self.assertIs(first['compression'], second['compression'])
+        self.assertIs(first['Stripes'][0]['Streams'][0]['section'],
+                      second['Stripes'][0]['Streams'][0]['section'])
+        for key in first['File Statistics'][0]:
+            self.assertIn(key, [k for k in second['File Statistics'][0]
+                                if k is key])
+
+    def test__records(self):
+        def as_dict(record, keys):
+            return dict((k, v) for k, v in zip(keys, record) if v is not None)
+
+        stats_keys = ['column', 'has null', 'count', 'min', 'max', 'sum']
+        stream_keys = ['section', 'column', 'start', 'length']
+        encoding_keys = ['encoding', 'column']
+        path = 'test/orc_files/TestOrcFile.testStripeLevelStats.orc'
+        kwargs = {'file_stats': True, 'stripe_stats': True, 'stripes': True}
+        expected_content = read_metadata(path, **kwargs)
+        with open(path, 'rb') as f:
+            content = f.read()
+        for actual_content in [read_metadata(path, records=True, **kwargs),
+                               read_metadata_buffer(content, records=True,
+                                                    **kwargs),
+                               read_metadata_many([path], records=True,
+                                                  **kwargs)[0][1]]:
+            for stats in actual_content['File Statistics']:
+                self.assertIsInstance(stats, ColumnStats)
+            self.assertEqual(
+                expected_content['File Statistics'],
+                [as_dict(s, stats_keys)
+                 for s in actual_content['File Statistics']])
+            for expected, actual in zip(
+                    expected_content['Stripe Statistics'],
+                    actual_content['Stripe Statistics']):
+                self.assertEqual(expected['statistics'],
+                                 [as_dict(s, stats_keys)
+                                  for s in actual['statistics']])
+            for expected, actual in zip(expected_content['Stripes'],
+                                        actual_content['Stripes']):
+                self.assertEqual(expected['Streams'],
+                                 [as_dict(s, stream_keys)
+                                  for s in actual['Streams']])
+                self.assertEqual(expected['Encodings'],
+                                 [as_dict(e, encoding_keys)
+                                  for e in actual['Encodings']])
+
+        metadata = open_metadata(path, records=True)
+        stream = metadata.stripe(0)['Streams'][0]
+        self.assertIsInstance(stream, StreamInfo)
+        self.assertIsInstance(metadata.stripe(0)['Encodings'][0],
+                              EncodingInfo)
+        self.assertEqual(expected_content['Stripes'][0]['Streams'][0],
+                         as_dict(stream, stream_keys))
+        self.assertEqual(stream.section, stream[0])
+        self.assertIsNone(metadata.file_stats[0].min)
+        self.assertEqual(stream, pkl.loads(pkl.dumps(stream)))
+
+    def test__column_stats(self):
+        def unpack(array):
+            view = memoryview(array)
+            return struct.unpack('={n}{f}'.format(n=len(array), f=view.format),
+                                 view.tobytes())
+
+        def bit(bitmap, i):
+            return bool(unpack(bitmap)[i // 8] >> (i % 8) & 1)
+
+        for name, stripe_range in [('TestOrcFile.testStripeLevelStats', None),
+                                   ('over1k_bloom', None),
+                                   ('demo-12-zstd', slice(None, None, -1))]:
+            if not compiled([name]):
+                continue
+            path = 'test/orc_files/{f}.orc'.format(f=name)
+            stripe_stats = read_metadata(path, stripe_stats=True,
+                                         stripe_range=stripe_range)
+            stripe_stats = [s['statistics']
+                            for s in stripe_stats['Stripe Statistics']]
+            columns = list(range(len(stripe_stats[0])))
+            metadata = open_metadata(path)
+            arrays = metadata.column_stats(columns, stripe_range=stripe_range)
+            self.assertEqual(columns, [a['column'] for a in arrays])
+            for column, array in zip(columns, arrays):
+                expected = [s[column] for s in stripe_stats]
+                self.assertEqual([s['count'] for s in expected],
+                                 list(unpack(array['count'])))
+                self.assertEqual([s['has null'] for s in expected],
+                                 [bit(array['has null'], i)
+                                  for i in range(len(expected))])
+                if array['kind'] not in ('int', 'double', 'date'):
+                    continue
+                for key in ['min', 'max']:
+                    self.assertEqual([s[key] for s in expected],
+                                     list(unpack(array[key])))
+                    self.assertTrue(all(bit(array['has bounds'], i)
+                                        for i in range(len(expected))))
+                if array['kind'] != 'date':
+                    self.assertEqual(
+                        [s.get('sum') for s in expected],
+                        [value if bit(array['has sum'], i) else None
+                         for i, value in enumerate(unpack(array['sum']))])
+
+        # Bounds past 32 bits, which used to be truncated
+        metadata = open_metadata('test/orc_files/over1k_bloom.orc')
+        array = metadata.column_stats([4])[0]
+        self.assertEqual('int', array['kind'])
+        self.assertEqual((4294967296, 4294967551),
+                         (unpack(array['min'])[0], unpack(array['max'])[0]))
+
+        metadata = open_metadata(path, columns=[1])
+        self.assertEqual(['int'], [a['kind'] for a in
+                                   metadata.column_stats([1])])
+        with self.assertRaises(ValueError):
+            metadata.column_stats([2])
+        with self.assertRaises(TypeError):
+            metadata.column_stats([1], stripe_range=(0, 1))
+
+    def test__arrow_export(self):
+        path = 'test/orc_files/TestOrcFile.testStripeLevelStats.orc'
+        metadata = open_metadata(path)
+        batch = metadata.stripe_table(stripe_range=slice(1, None))
+        self.assertEqual(2, batch.num_rows)
+        schema, array = batch.__arrow_c_array__()
+        self.assertIn('"arrow_schema"', repr(schema))
+        self.assertIn('"arrow_array"', repr(array))
+        self.assertIn('"arrow_schema"', repr(batch.__arrow_c_schema__()))
+        self.assertEqual(1, metadata.file_stats_table().num_rows)
+        with self.assertRaises(ValueError):
+            metadata.stripe_table(columns=[3])
+        with self.assertRaises(ValueError):
+            open_metadata(path, columns=[1]).file_stats_table(columns=[2])
+
+    def test__arrow_import(self):
+        try:
+            import pyarrow
+        except ImportError:
+            self.skipTest("pyarrow not available.")
+
+        for name in ['TestOrcFile.testStripeLevelStats', 'decimal',
+                     'TestOrcFile.testDate1900', 'over1k_bloom']:
+            path = 'test/orc_files/{f}.orc'.format(f=name)
+            expected_content = read_metadata(path, file_stats=True,
+                                             stripe_stats=True, stripes=True)
+            metadata = open_metadata(path)
+            table = pyarrow.record_batch(metadata.stripe_table())
+            table.validate(full=True)
+            file_stats = pyarrow.record_batch(metadata.file_stats_table())
+            rows = table.to_pylist() + file_stats.to_pylist()
+            stats = [s['statistics']
+                     for s in expected_content['Stripe Statistics']]
+            stats.append(expected_content['File Statistics'])
+            for stripe, row in zip(expected_content['Stripes'], rows):
+                for key in ['stripe', 'offset', 'index', 'data', 'tail',
+                            'rows']:
+                    self.assertEqual(stripe[key], row[key])
+            for column_stats, row in zip(stats, rows):
+                for s in column_stats:
+                    prefix = '{c}.'.format(c=s['column'])
+                    self.assertEqual(s['count'], row[prefix + 'count'])
+                    self.assertEqual(s['has null'], row[prefix + 'has null'])
+                    if 'min' not in s:
+                        continue
+                    bounds = [row[prefix + 'min'], row[prefix + 'max']]
+                    if isinstance(bounds[0], datetime.date):
+                        bounds = [(d - EPOCH).days for d in bounds]
+                    self.assertEqual([s['min'], s['max']], bounds)
+                    if prefix + 'sum' in row:
+                        self.assertEqual(s.get('sum'), row[prefix + 'sum'])
+
     def test__TestOrcFile_partial_footer_stats(self):
         actual_content = read_metadata('test/orc_files/TestOrcFile.partial.orc',
                                        schema=True, file_stats=True,
                                        stripe_stats=True)
 
-        with open('test/expected_output/TestOrcFile.partial.pkl', 'r') as f:
-            expected_content = pkl.loads(f.read())
+        expected_content = load_expected('TestOrcFile.partial')
         self.assertDictEqual(expected_content, actual_content)
 
+    def test__lazy_footer(self):
+        path = 'test/orc_files/TestOrcFile.testStripeLevelStats.orc'
+        full_content = read_metadata(path, schema=True, file_stats=True,
+                                     stripes=True)
+        options = {'schema': 'schema', 'file_stats': 'File Statistics',
+                   'stripes': 'Stripes'}
+        base_keys = ['rows', 'compression', 'version', 'compression_size']
+
+        actual_content = read_metadata(path)
+        self.assertEqual(sorted(base_keys), sorted(actual_content.keys()))
+        for key in base_keys:
+            self.assertEqual(full_content[key], actual_content[key])
+
+        for option, key in options.items():
+            actual_content = read_metadata(path, **{option: True})
+            self.assertEqual(full_content[key], actual_content[key])
+
+    def test__column_projection(self):
+        path = 'test/orc_files/TestOrcFile.test1.orc'
+        full_content = read_metadata(path, file_stats=True,
+                                     stripe_stats=True)
+
+        for columns in [[], [0], [2, 9], [9, 2, 2, 100], [10 ** 9, 3],
+                        [2 ** 62]]:
+            selected = set(columns)
+            actual_content = read_metadata(path, file_stats=True,
+                                           stripe_stats=True, columns=columns)
+            self.assertEqual(
+                [s for s in full_content['File Statistics']
+                 if s['column'] in selected],
+                actual_content['File Statistics'])
+            for full_stripe, stripe in zip(full_content['Stripe Statistics'],
+                                           actual_content['Stripe Statistics']):
+                self.assertEqual(full_stripe['stripe'], stripe['stripe'])
+                self.assertEqual([s for s in full_stripe['statistics']
+                                  if s['column'] in selected],
+                                 stripe['statistics'])
+
+        with self.assertRaises(ValueError):
+            read_metadata(path, file_stats=True, columns=[-1])
+        with self.assertRaises(TypeError):
+            read_metadata(path, file_stats=True, columns=1)
+
+    def test__stripe_range(self):
+        path = 'test/orc_files/TestOrcFile.testStripeLevelStats.orc'
+        full_stats = read_metadata(path, stripe_stats=True)['Stripe Statistics']
+        self.assertTrue(len(full_stats) > 2)
+
+        for stripe_range in [slice(None), slice(1, 2), slice(-2, None),
+                             slice(None, None, -1), slice(5, 10)]:
+            actual_stats = read_metadata(path, stripe_stats=True,
+                                         stripe_range=stripe_range)
+            self.assertEqual(full_stats[stripe_range],
+                             actual_stats['Stripe Statistics'])
+
+        with self.assertRaises(TypeError):
+            read_metadata(path, stripe_stats=True, stripe_range=(0, 1))
+        with self.assertRaises(ValueError):
+            read_metadata(path, stripe_stats=True,
+                          stripe_range=slice(None, None, 0))
+
+    def test__json(self):
+        path = 'test/orc_files/TestOrcFile.testStringAndBinaryStatistics.orc'
+        with open(path, 'rb') as f:
+            content = f.read()
+        for kwargs in [{}, {'schema': True, 'stripes': True},
+                       {'file_stats': True, 'columns': [0, 2]},
+                       {'stripe_stats': True,
+                        'stripe_range': slice(None, None, -1)}]:
+            expected_content = read_metadata(path, **kwargs)
+            indented = read_metadata_json(path, **kwargs)
+            ndjson = read_metadata_buffer_json(content, ndjson=True, **kwargs)
+            self.assertEqual(indented, read_metadata_buffer_json(content,
+                                                                 **kwargs))
+            self.assertEqual(1, ndjson.count(b'\n'))
+            self.assertTrue(ndjson.endswith(b'\n'))
+            if sys.version_info[0] < 3:
+                # Python 2 dicts keep no insertion order, the keys must
+                # still come out in the order json.dumps writes them in
+                self.assertEqual(json.dumps(expected_content, indent=4),
+                                 indented)
+                self.assertEqual(json.dumps(expected_content) + '\n', ndjson)
+            for actual in [indented, ndjson]:
+                self.assertEqual(expected_content,
+                                 json.loads(actual.decode('utf-8')))
+
+        with tempfile.TemporaryFile() as f:
+            f.write(b'[')
+            self.assertIsNone(read_metadata_json(path, ndjson=True, output=f))
+            self.assertIsNone(read_metadata_json(path, ndjson=True,
+                                                 output=f.fileno()))
+            f.seek(0)
+            self.assertEqual(b'[' + 2 * read_metadata_json(path, ndjson=True),
+                             f.read())
+
+        with self.assertRaises(IOError):
+            read_metadata_json('test/orc_files/missing.orc')
+        with self.assertRaises(ORCReadException):
+            read_metadata_buffer_json(content[-100:], stripes=True)
+        with self.assertRaises(TypeError):
+            read_metadata_json(path, stripe_stats=True, stripe_range=(0, 1))
+
+
+class S3Handler(BaseHTTPRequestHandler):
+    """Path-style ListObjects and ranged GetObject of an S3-compatible
+    endpoint, serving the objects of its server."""
+
+    protocol_version = 'HTTP/1.1'
+
+    def log_message(self, *args):
+        pass
+
+    def send(self, status, body, headers=()):
+        self.send_response(status)
+        for name, value in headers:
+            self.send_header(name, value)
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def error(self, status, code):
+        return (status, '<?xml version="1.0" encoding="UTF-8"?>'
+                '<Error><Code>{}</Code></Error>'.format(code).encode(),
+                [('Content-Type', 'application/xml')])
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        bucket, _, key = unquote(url.path).lstrip('/').partition('/')
+        if not key:
+            return self.send(*self.list_objects(parse_qs(url.query)))
+
+        # A request stops counting as in flight once its response is ready,
+        # before it is sent and the client can issue the next one
+        server = self.server
+        with server.lock:
+            server.requests.append((key, self.headers.get('Range')))
+            server.in_flight += 1
+            server.max_in_flight = max(server.max_in_flight,
+                                       server.in_flight)
+        try:
+            time.sleep(server.latency)
+            if key not in server.objects:
+                response = self.error(404, 'NoSuchKey')
+            else:
+                response = self.get_object(server.objects[key],
+                                           self.headers.get('Range'))
+        finally:
+            with server.lock:
+                server.in_flight -= 1
+        self.send(*response)
+
+    def get_object(self, body, byte_range):
+        # A single range as in RFC 7233, malformed ranges are ignored and the
+        # whole object is returned like S3 does
+        match = re.match(r'^bytes=(\d*)-(\d*)$', byte_range or '')
+        if match is None or match.groups() == ('', ''):
+            return 200, body, []
+        first, last = match.groups()
+        if not first:
+            first, last = max(0, len(body) - int(last)), len(body) - 1
+            if len(body) == 0 or last < first:
+                first = len(body)
+        else:
+            first = int(first)
+            last = min(int(last), len(body) - 1) if last else len(body) - 1
+        if first >= len(body) or last < first:
+            return self.error(416, 'InvalidRange')
+        return 206, body[first:last + 1], [
+            ('Content-Range', 'bytes {}-{}/{}'.format(first, last,
+                                                      len(body)))]
+
+    def list_objects(self, query):
+        prefix = query.get('prefix', [''])[0]
+        marker = query.get('marker', [''])[0]
+        max_keys = min(int(query.get('max-keys', ['1000'])[0]),
+                       self.server.page_size)
+        keys = sorted(k for k in self.server.objects
+                      if k.startswith(prefix) and k > marker)
+        page = keys[:max_keys]
+        contents = ''.join(
+            '<Contents><Key>{}</Key><Size>{}</Size></Contents>'.format(
+                xml_escape(k), len(self.server.objects[k])) for k in page)
+        truncated = len(keys) > len(page)
+        next_marker = ('<NextMarker>{}</NextMarker>'.format(
+            xml_escape(page[-1])) if truncated else '')
+        return 200, (
+            '<?xml version="1.0" encoding="UTF-8"?>'
+            '<ListBucketResult xmlns="{}"><Prefix>{}</Prefix>'
+            '<Marker>{}</Marker><MaxKeys>{}</MaxKeys>'
+            '<IsTruncated>{}</IsTruncated>{}{}</ListBucketResult>').format(
+                S3_NAMESPACE, xml_escape(prefix), xml_escape(marker),
+                max_keys, 'true' if truncated else 'false', contents,
+                next_marker).encode('utf-8'), [
+                    ('Content-Type', 'application/xml')]
+
+
+class S3Server(ThreadingMixIn, HTTPServer):
+    """Local stand-in for S3, counting the GETs of objects it serves."""
+
+    daemon_threads = True
+
+    def __init__(self, objects, page_size=1000, latency=0):
+        HTTPServer.__init__(self, ('127.0.0.1', 0), S3Handler)
+        self.objects = objects
+        self.page_size = page_size
+        self.latency = latency
+        self.requests = []
+        self.in_flight = 0
+        self.max_in_flight = 0
+        self.lock = threading.Lock()
+        self.thread = threading.Thread(target=self.serve_forever)
+        self.thread.daemon = True
+        self.thread.start()
+
+    @property
+    def endpoint(self):
+        return 'http://127.0.0.1:{}'.format(self.server_address[1])
+
+    def stop(self):
+        self.shutdown()
+        self.thread.join()
+        self.server_close()
+
+
+class RecordingBudget(orc_metadata.reader._ByteBudget):
+    """Byte budget of the concurrent scanner keeping the most bytes it let
+    in flight at once for more than one object. A single object larger than
+    the budget is let through alone and does not count."""
+
+    def __init__(self, max_bytes):
+        super(RecordingBudget, self).__init__(max_bytes)
+        self.held = 0
+        self.peak = 0
+        RecordingBudget.last = self
+
+    def record(self):
+        if self.held > 1:
+            self.peak = max(self.peak, self._in_flight)
+
+    def acquire(self, size):
+        with self._cond:
+            super(RecordingBudget, self).acquire(size)
+            self.held += 1
+            self.record()
+
+    def grow(self, size):
+        with self._cond:
+            super(RecordingBudget, self).grow(size)
+            self.record()
+
+    def release(self, size):
+        with self._cond:
+            self.held -= 1
+            super(RecordingBudget, self).release(size)
+
+
+class S3Error(Exception):
+    pass
+
+
+class HTTPS3Client(object):
+    """The S3 calls the readers make, sent over HTTP to the local server
+    when boto3 is not installed."""
+
+    def __init__(self, endpoint):
+        self.address = urlparse(endpoint).netloc
+
+    def request(self, path, headers):
+        conn = HTTPConnection(self.address)
+        try:
+            conn.request('GET', path, headers=headers)
+            resp = conn.getresponse()
+            body = resp.read()
+        finally:
+            conn.close()
+        if resp.status not in (200, 206):
+            raise S3Error(resp.status, body)
+        return body
+
+    def get_paginator(self, operation):
+        assert operation == 'list_objects'
+        return self
+
+    def paginate(self, Bucket, Prefix):
+        marker = ''
+        while True:
+            root = ElementTree.fromstring(self.request(
+                '/{}?prefix={}&marker={}'.format(Bucket, quote(Prefix),
+                                                 quote(marker)), {}))
+            ns = '{' + S3_NAMESPACE + '}'
+            yield {'Contents': [{'Key': c.find(ns + 'Key').text,
+                                 'Size': int(c.find(ns + 'Size').text)}
+                                for c in root.findall(ns + 'Contents')]}
+            if root.find(ns + 'IsTruncated').text != 'true':
+                return
+            marker = root.find(ns + 'NextMarker').text
+
+    def get_object(self, Bucket, Key, Range=None):
+        headers = {'Range': Range} if Range is not None else {}
+        path = '/{}/{}'.format(Bucket, quote(Key))
+        return {'Body': io.BytesIO(self.request(path, headers))}
+
+
+def s3_client(server):
+    try:
+        import boto3
+        from botocore.config import Config
+    except ImportError:
+        return HTTPS3Client(server.endpoint)
+    return boto3.client('s3', endpoint_url=server.endpoint,
+                        region_name='us-east-1', aws_access_key_id='test',
+                        aws_secret_access_key='test',
+                        config=Config(s3={'addressing_style': 'path'},
+                                      max_pool_connections=32))
+
 
-def test_file_read(filename):
+class TestS3Reader(unittest.TestCase):
+
+    def setUp(self):
+        self.objects = {}
+        for name in ['TestOrcFile.metaData', 'TestOrcFile.testSeek',
+                     'TestOrcFile.testTimestamp']:
+            with open('test/orc_files/{f}.orc'.format(f=name), 'rb') as f:
+                self.objects['prefix/{f}.orc'.format(f=name)] = f.read()
+        self.objects['prefix/$folder$'] = b''
+        self.servers = []
+
+    def tearDown(self):
+        for server in self.servers:
+            server.stop()
+
+    def serve(self, objects, **kwargs):
+        server = S3Server(objects, **kwargs)
+        self.servers.append(server)
+        return server, s3_client(server)
+
+    def expected(self, **kwargs):
+        return [read_metadata_buffer(self.objects[k], **kwargs)
+                for k in sorted(self.objects) if not k.endswith('$folder$')]
+
+    def test__range_requests(self):
+        server, s3 = self.serve(self.objects)
+        key = 'prefix/TestOrcFile.testTimestamp.orc'
+        body = self.objects[key]
+        for byte_range, expected in [
+                ('bytes=10-19', body[10:20]), ('bytes=-16', body[-16:]),
+                ('bytes=100-', body[100:]), ('bytes=-100000', body),
+                ('bytes=0-100000', body), ('bytes=-5-', body)]:
+            resp = s3.get_object(Bucket='bucket', Key=key, Range=byte_range)
+            self.assertEqual(expected, resp['Body'].read())
+        with self.assertRaises(Exception):
+            s3.get_object(Bucket='bucket', Key=key,
+                          Range='bytes={}-'.format(len(body)))
+
+    def test__adaptive_fetch(self):
+        server, s3 = self.serve(self.objects)
+        actual = list(read_metadata_s3('bucket', 'prefix/', fetch_size='auto',
+                                       schema=True, file_stats=True,
+                                       stripe_stats=True, client=s3))
+        self.assertEqual(self.expected(schema=True, file_stats=True,
+                                       stripe_stats=True), actual)
+
+        # Only the large metadata section needs a second, exact range
+        ranges = [r for k, r in server.requests if 'metaData' in k]
+        self.assertEqual(['bytes=25551-41934', 'bytes=980-25550'], ranges)
+        for key in ['prefix/TestOrcFile.testSeek.orc',
+                    'prefix/TestOrcFile.testTimestamp.orc']:
+            self.assertEqual(1, len([k for k, r in server.requests
+                                     if k == key]))
+
+    def test__full_fetch(self):
+        server, s3 = self.serve(self.objects)
+        actual = list(read_metadata_s3('bucket', 'prefix/', stripes=True,
+                                       client=s3))
+        self.assertEqual(self.expected(stripes=True), actual)
+        self.assertTrue(all(r is None for k, r in server.requests))
+
+    def test__fixed_fetch(self):
+        # Only testSeek is larger than the fetch size, the others come whole
+        server, s3 = self.serve(self.objects)
+        actual = list(read_metadata_s3('bucket', 'prefix/', fetch_size=65536,
+                                       file_stats=True, client=s3))
+        self.assertEqual(self.expected(file_stats=True), actual)
+        self.assertEqual(set(['bytes=-65536']),
+                         set(r for k, r in server.requests))
+
+    def many_objects(self):
+        objects = {}
+        for i in range(40):
+            for key, body in self.objects.items():
+                objects['prefix/{:02d}/{}'.format(i, key)] = body
+        return objects
+
+    def test__concurrent_scan(self):
+        objects = self.many_objects()
+        server, s3 = self.serve(objects, page_size=7, latency=0.002)
+        actual = list(read_metadata_s3_concurrent('bucket', 'prefix/',
+                                                  file_stats=True,
+                                                  stripe_stats=True,
+                                                  workers=8,
+                                                  max_inflight_requests=3,
+                                                  client=s3))
+        expected = dict((k, read_metadata_buffer(objects[k], file_stats=True,
+                                                 stripe_stats=True))
+                        for k in objects if not k.endswith('$folder$'))
+        self.assertEqual(len(expected), len(actual))
+        self.assertEqual(expected, dict(actual))
+        self.assertTrue(server.max_in_flight <= 3)
+
+    def test__concurrent_scan_ordered(self):
+        objects = self.many_objects()
+        server, s3 = self.serve(objects, page_size=5, latency=0.002)
+        budget = orc_metadata.reader._ByteBudget
+        orc_metadata.reader._ByteBudget = RecordingBudget
+        self.addCleanup(setattr, orc_metadata.reader, '_ByteBudget', budget)
+        actual = list(read_metadata_s3_concurrent('bucket', 'prefix/',
+                                                  workers=4, ordered=True,
+                                                  max_inflight_bytes=1024,
+                                                  client=s3))
+        keys = sorted(k for k in objects if not k.endswith('$folder$'))
+        self.assertEqual(keys, [k for k, _ in actual])
+        self.assertEqual([read_metadata_buffer(objects[k]) for k in keys],
+                         [v for _, v in actual])
+
+        # The 289 byte objects share the budget, the larger ones go alone
+        self.assertTrue(0 < RecordingBudget.last.peak <= 1024)
+
+    def test__concurrent_scan_error(self):
+        objects = self.many_objects()
+        objects['prefix/99/broken.orc'] = b'not an orc file'
+        server, s3 = self.serve(objects)
+        with self.assertRaises(ORCReadException):
+            list(read_metadata_s3_concurrent('bucket', 'prefix/', client=s3))
+
+
+def skip_unless_compiled(test, compression):
+    # Files of codecs the reader was built without fail to decompress, which
+    # is only expected of those and must not hide failures of the others
+    if compression not in compressions:
+        test.skipTest("Reader not compiled for %s." % compression)
+
+
+def compiled(filenames):
+    # Files whose codec the reader was built with, for tests over several
+    return [filename for filename in filenames
+            if load_expected(filename)['compression'] in compressions]
+
+
+def test_file_read(filename, use_mmap=False):
     def test_expected(self):
         in_file_directory = 'test/orc_files/{f}.orc'
-        expected_result_directory = 'test/expected_output/{f}.pkl'
 
-        try:
-            actual_content = read_metadata(in_file_directory.format(f=filename),
-                                           schema=True, file_stats=True,
-                                           stripe_stats=True, stripes=True)
-        except ORCReadException:
-            self.skipTest("Reader not compiled for this compression.")
-
-        with open(expected_result_directory.format(f=filename), 'r') as f:
-            expected_content = pkl.loads(f.read())
+        expected_content = load_expected(filename)
+        skip_unless_compiled(self, expected_content['compression'])
+
+        actual_content = read_metadata(in_file_directory.format(f=filename),
+                                       schema=True, file_stats=True,
+                                       stripe_stats=True, stripes=True,
+                                       use_mmap=use_mmap)
         self.assertDictEqual(expected_content, actual_content)
     return test_expected
 
 
+def test_file_json(filename):
+    def test_expected(self):
+        in_file_directory = 'test/orc_files/{f}.orc'
+
+        skip_unless_compiled(self, load_expected(filename)['compression'])
+
+        actual_content = read_metadata_json(
+            in_file_directory.format(f=filename), schema=True,
+            file_stats=True, stripe_stats=True, stripes=True)
+
+        with open('test/expected_output_json/{f}.json'.format(f=filename),
+                  'rb') as f:
+            self.assertEqual(f.read(), actual_content)
+    return test_expected
+
+
 if __name__ == '__main__':
     for test_case in TEST_CASES:
         filename = test_case
@@ -77,4 +1087,12 @@ if __name__ == '__main__':
         test_func.__name__ = 'test__%s' % filename.replace('.', '_')
         setattr(TestReader, test_func.__name__, test_func)
 
+        test_func = test_file_read(filename, use_mmap=True)
+        test_func.__name__ = 'test__%s_mmap' % filename.replace('.', '_')
+        setattr(TestReader, test_func.__name__, test_func)
+
+        test_func = test_file_json(filename)
+        test_func.__name__ = 'test__%s_json' % filename.replace('.', '_')
+        setattr(TestReader, test_func.__name__, test_func)
+
     unittest.main()